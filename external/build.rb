@@ -16,7 +16,8 @@ $order = {
   :packages => [
                 "boost",
                 "bp-file",
-                "service_testing"
+                "service_testing",
+                "zlib"
                ],
   :verbose => true,
   :use_source => {
@@ -0,0 +1,389 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+// Discovery benchmark.  Generates BrowserPlus directory trees of
+// varying shape below a scratch directory, points discovery at them
+// and reports latency percentiles and filesystem call counts for each
+// discovery path.  Run it before and after touching logaccess_util,
+// logaccess_dir or logaccess_cache.
+//
+//   LogAccessBench [--dir <scratch>] [--versions 1,20,200] [--installs 8]
+//                  [--services 300] [--log-mb 64] [--iterations 200] [--keep]
+//
+// Each generated tree has <versions> platform version dirs, each holding
+// <installs> install id dirs.  Every install dir has a BrowserPlus.config,
+// the newest quarter of the versions (installed but never run) have
+// nothing else, and one install dir of the newest version below those
+// holds the logs.  Each of the <services> services has three major
+// version dirs with its logs in the newest.  Logs are sparse files of
+// <log-mb> megabytes, discovery only ever looks at their size and time.
+
+#include "logaccess_cache.h"
+#include "logaccess_stats.h"
+#include "logaccess_util.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace {
+    struct Options {
+        Options() : installs(8), services(300), logMb(64), iterations(200), keep(false) {
+            versions.push_back(1);
+            versions.push_back(20);
+            versions.push_back(200);
+        }
+        fs::path dir;
+        std::vector<unsigned int> versions;
+        unsigned int installs;
+        unsigned int services;
+        unsigned int logMb;
+        unsigned int iterations;
+        bool keep;
+    };
+
+    struct Sample {
+        Sample() : us(0), opens(0), reads(0), stats(0) {}
+        long long us;
+        unsigned long opens;
+        unsigned long reads;
+        unsigned long stats;
+    };
+
+    bool fasterSample(const Sample& a, const Sample& b) {
+        return a.us < b.us;
+    }
+}
+
+static void
+usage() {
+    fprintf(stderr, "usage: LogAccessBench [--dir <scratch>] [--versions 1,20,200] "
+            "[--installs 8]\n"
+            "                      [--services 300] [--log-mb 64] "
+            "[--iterations 200] [--keep]\n");
+    exit(2);
+}
+
+static unsigned int
+parseCount(const char* s) {
+    char* end = NULL;
+    unsigned long n = strtoul(s, &end, 10);
+    if (!end || *end || n == 0) {
+        usage();
+    }
+    return (unsigned int) n;
+}
+
+static void
+parseArgs(int argc, char** argv, Options& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--keep") {
+            opts.keep = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+        }
+        const char* value = argv[++i];
+        if (arg == "--dir") {
+            opts.dir = value;
+        } else if (arg == "--versions") {
+            opts.versions.clear();
+            std::stringstream ss(value);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                opts.versions.push_back(parseCount(item.c_str()));
+            }
+        } else if (arg == "--installs") {
+            opts.installs = parseCount(value);
+        } else if (arg == "--services") {
+            opts.services = parseCount(value);
+        } else if (arg == "--log-mb") {
+            opts.logMb = parseCount(value);
+        } else if (arg == "--iterations") {
+            opts.iterations = parseCount(value);
+        } else {
+            usage();
+        }
+    }
+}
+
+static void
+touch(const fs::path& file, boost::uintmax_t size) {
+    fs::ofstream os(file);
+    os.close();
+    if (size) {
+        fs::resize_file(file, size);
+    }
+}
+
+static std::string
+installId(unsigned int i) {
+    char buf[32];
+    sprintf(buf, "%08X-%04X", i * 2654435761u, i);
+    return buf;
+}
+
+static void
+generate(const logaccess::util::Roots& roots, unsigned int versions, const Options& opts) {
+    boost::uintmax_t logSize = (boost::uintmax_t) opts.logMb << 20;
+    unsigned int logVersion = versions - 1 - versions / 4;
+    for (unsigned int v = 0; v < versions; v++) {
+        std::stringstream name;
+        name << "2." << v / 100 << "." << v % 100;
+        fs::path versionDir = roots.platformDir / name.str();
+        for (unsigned int i = 0; i < opts.installs; i++) {
+            fs::path installDir = versionDir / installId(i);
+            fs::create_directories(installDir);
+            touch(installDir / "BrowserPlus.config", 4096);
+            if (v == logVersion && i == opts.installs / 2) {
+                touch(installDir / "BrowserPlusCore.log", logSize);
+                touch(installDir / "BrowserPlusPluginHost.log", logSize / 4);
+                touch(installDir / "BrowserPlusUpdater.log", logSize / 16);
+            }
+        }
+        fs::create_directories(versionDir / "Permissions");
+    }
+    for (unsigned int s = 0; s < opts.services; s++) {
+        std::stringstream name;
+        name << "Service" << s;
+        fs::path serviceDir = roots.serviceDataDir / name.str();
+        for (unsigned int major = 1; major <= 3; major++) {
+            std::stringstream m;
+            m << major;
+            fs::path majorDir = serviceDir / m.str();
+            fs::create_directories(majorDir / "cache");
+            touch(majorDir / "settings.json", 1024);
+            if (major == 3) {
+                touch(majorDir / (name.str() + ".log"), logSize / 8);
+                touch(majorDir / (name.str() + ".1.log"), logSize / 8);
+            }
+        }
+    }
+}
+
+// the filesystem calls made so far, counted against no method in
+// particular since the bench calls discovery directly
+static logaccess::stats::Totals
+counters() {
+    std::vector<logaccess::stats::Totals> totals;
+    logaccess::stats::totals(totals);
+    return totals[logaccess::stats::kOther];
+}
+
+// time one call, with the filesystem calls it made
+template <class F>
+static Sample
+measure(F f) {
+    logaccess::stats::Totals before = counters();
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    f();
+    Sample s;
+    s.us = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+    logaccess::stats::Totals after = counters();
+    s.opens = after.counters[logaccess::stats::kDirsOpened] - before.counters[logaccess::stats::kDirsOpened];
+    s.reads = after.counters[logaccess::stats::kEntriesScanned] - before.counters[logaccess::stats::kEntriesScanned];
+    s.stats = after.counters[logaccess::stats::kStatCalls] - before.counters[logaccess::stats::kStatCalls];
+    return s;
+}
+
+static void
+report(const char* what, std::vector<Sample>& samples) {
+    if (samples.empty()) {
+        return;
+    }
+    double opens = 0, reads = 0, stats = 0;
+    for (std::vector<Sample>::const_iterator it = samples.begin(); it != samples.end(); ++it) {
+        opens += it->opens;
+        reads += it->reads;
+        stats += it->stats;
+    }
+    std::sort(samples.begin(), samples.end(), fasterSample);
+    size_t n = samples.size();
+    printf("  %-28s %9lld %9lld %9lld %9lld %8.1f %8.1f %8.1f\n", what,
+           samples[n / 2].us, samples[n * 90 / 100].us, samples[n * 99 / 100].us,
+           samples[n - 1].us, opens / n, reads / n, stats / n);
+}
+
+namespace {
+    // the discovery paths, as nullary calls for measure()
+    struct FindLogDir {
+        const logaccess::util::Roots* roots;
+        void operator()() const {
+            fs::path logDir;
+            std::vector<fs::path> visited;
+            std::string error = logaccess::util::findLogDir(*roots, logDir, visited);
+            if (!error.empty()) {
+                fprintf(stderr, "findLogDir: %s\n", error.c_str());
+                exit(1);
+            }
+        }
+    };
+
+    struct FindServiceLogDir {
+        const logaccess::util::Roots* roots;
+        std::string service;
+        void operator()() const {
+            fs::path logDir;
+            std::vector<fs::path> visited;
+            std::string error = logaccess::util::findServiceLogDir(*roots, service, logDir, visited);
+            if (!error.empty()) {
+                fprintf(stderr, "findServiceLogDir: %s\n", error.c_str());
+                exit(1);
+            }
+        }
+    };
+
+    struct GetLogfilePaths {
+        const logaccess::util::Roots* roots;
+        logaccess::LogDirCache* cache;
+        void operator()() const {
+            bplus::List paths;
+            std::string error = cache ? cache->getLogfilePaths(paths)
+                                      : logaccess::util::getLogfilePaths(*roots, paths);
+            if (!error.empty() || paths.size() == 0) {
+                fprintf(stderr, "getLogfilePaths: %s\n", error.c_str());
+                exit(1);
+            }
+        }
+    };
+
+    struct GetServiceLogfilePaths {
+        const logaccess::util::Roots* roots;
+        logaccess::LogDirCache* cache;
+        std::string service;
+        void operator()() const {
+            bplus::List paths;
+            std::string error = cache ? cache->getServiceLogfilePaths(service, paths)
+                                      : logaccess::util::getServiceLogfilePaths(*roots, service, paths);
+            if (!error.empty() || paths.size() == 0) {
+                fprintf(stderr, "getServiceLogfilePaths: %s\n", error.c_str());
+                exit(1);
+            }
+        }
+    };
+}
+
+// how many distinct services the cached path cycles through, a page
+// asks about the same few over and over
+static const unsigned int kHotServices = 16;
+
+static std::string
+serviceName(unsigned int i, const Options& opts) {
+    std::stringstream name;
+    name << "Service" << (i * 7919u) % opts.services;
+    return name.str();
+}
+
+static void
+run(const logaccess::util::Roots& roots, unsigned int versions, const Options& opts) {
+    printf("versions %u, installs %u, services %u, logs %u MB\n",
+           versions, opts.installs, opts.services, opts.logMb);
+    printf("  %-28s %9s %9s %9s %9s %8s %8s %8s\n", "path", "p50 us", "p90 us",
+           "p99 us", "max us", "opens", "reads", "stats");
+    std::vector<Sample> samples;
+
+    FindLogDir findLogDir = { &roots };
+    for (unsigned int i = 0; i < opts.iterations; i++) {
+        samples.push_back(measure(findLogDir));
+    }
+    report("findLogDir", samples);
+
+    samples.clear();
+    for (unsigned int i = 0; i < opts.iterations; i++) {
+        FindServiceLogDir f = { &roots, serviceName(i, opts) };
+        samples.push_back(measure(f));
+    }
+    report("findServiceLogDir", samples);
+
+    samples.clear();
+    GetLogfilePaths getLogs = { &roots, NULL };
+    for (unsigned int i = 0; i < opts.iterations; i++) {
+        samples.push_back(measure(getLogs));
+    }
+    report("getLogfilePaths", samples);
+
+    samples.clear();
+    for (unsigned int i = 0; i < opts.iterations; i++) {
+        GetServiceLogfilePaths f = { &roots, NULL, serviceName(i, opts) };
+        samples.push_back(measure(f));
+    }
+    report("getServiceLogfilePaths", samples);
+
+    // the first call through the cache discovers, the rest only list
+    logaccess::LogDirCache cache(roots);
+    samples.clear();
+    GetLogfilePaths cachedLogs = { &roots, &cache };
+    for (unsigned int i = 0; i < opts.iterations; i++) {
+        samples.push_back(measure(cachedLogs));
+    }
+    report("cached getLogfilePaths", samples);
+
+    samples.clear();
+    for (unsigned int i = 0; i < opts.iterations; i++) {
+        GetServiceLogfilePaths f = { &roots, &cache, serviceName(i % kHotServices, opts) };
+        samples.push_back(measure(f));
+    }
+    report("cached getServiceLogfilePaths", samples);
+    printf("\n");
+}
+
+int
+main(int argc, char** argv) {
+    Options opts;
+    parseArgs(argc, argv, opts);
+    if (opts.dir.empty()) {
+        opts.dir = fs::temp_directory_path() / fs::unique_path("logaccess-bench-%%%%%%%%");
+    }
+    for (std::vector<unsigned int>::const_iterator it = opts.versions.begin();
+         it != opts.versions.end(); ++it) {
+        std::stringstream name;
+        name << "v" << *it;
+        fs::path treeDir = opts.dir / name.str();
+        logaccess::util::Roots roots;
+        roots.platformDir = treeDir / "Yahoo!" / "BrowserPlus";
+        roots.serviceDataDir = roots.platformDir / "CoreletData";
+        try {
+            fs::remove_all(treeDir);
+            generate(roots, *it, opts);
+        } catch (const fs::filesystem_error& e) {
+            fprintf(stderr, "couldn't generate %s: %s\n", treeDir.string().c_str(), e.what());
+            return 1;
+        }
+        run(roots, *it, opts);
+        if (!opts.keep) {
+            fs::remove_all(treeDir);
+        }
+    }
+    if (!opts.keep) {
+        fs::remove_all(opts.dir);
+    }
+    return 0;
+}
@@ -0,0 +1,297 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_bundle.h"
+#include "logaccess_file.h"
+#include "logaccess_pool.h"
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/utility.hpp>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <zlib.h>
+
+// how much of a file is read or written at a time
+static const std::size_t kChunkSize = 64 * 1024;
+
+// sizes a plain (non zip64) archive can describe
+static const boost::uint64_t kMaxZipSize = 0xffffffffULL;
+static const std::size_t kMaxZipEntries = 0xffff;
+
+namespace {
+    // a file deflated into a part file, waiting to go into the archive
+    struct Part {
+        Part() : crc(0), size(0), compressedSize(0), dosTime(0), dosDate(0) {}
+        boost::filesystem::path path;
+        boost::uint32_t crc;
+        boost::uint64_t size;
+        boost::uint64_t compressedSize;
+        boost::uint16_t dosTime;
+        boost::uint16_t dosDate;
+        std::string error;
+    };
+
+    // removes the part files when the bundle is done with them, however
+    // it finishes
+    class PartFiles : boost::noncopyable {
+    public:
+        explicit PartFiles(const std::vector<Part>& parts) : m_parts(parts) {}
+        ~PartFiles() {
+            for (std::vector<Part>::const_iterator it = m_parts.begin(); it != m_parts.end(); ++it) {
+                if (!it->path.empty()) {
+                    boost::system::error_code ec;
+                    boost::filesystem::remove(it->path, ec);
+                }
+            }
+        }
+    private:
+        const std::vector<Part>& m_parts;
+    };
+
+    // little endian writer for zip headers
+    class Header {
+    public:
+        void u16(boost::uint16_t v) {
+            m_buf.push_back((char) (v & 0xff));
+            m_buf.push_back((char) (v >> 8));
+        }
+        void u32(boost::uint32_t v) {
+            u16((boost::uint16_t) (v & 0xffff));
+            u16((boost::uint16_t) (v >> 16));
+        }
+        void bytes(const std::string& s) {
+            m_buf.append(s);
+        }
+        const std::string& str() const { return m_buf; }
+    private:
+        std::string m_buf;
+    };
+}
+
+static void
+dosTimestamp(std::time_t t, boost::uint16_t& dosTime, boost::uint16_t& dosDate) {
+    // the entries are compressed in parallel, so not localtime(), whose
+    // result is shared
+    struct tm local;
+#ifdef WINDOWS
+    struct tm* tm = (localtime_s(&local, &t) == 0) ? &local : NULL;
+#else
+    struct tm* tm = localtime_r(&t, &local);
+#endif
+    if (!tm || tm->tm_year < 80) {
+        // zip can't represent times before 1980
+        dosTime = 0;
+        dosDate = (1 << 5) | 1;
+        return;
+    }
+    dosTime = (boost::uint16_t) ((tm->tm_hour << 11) | (tm->tm_min << 5) | (tm->tm_sec / 2));
+    dosDate = (boost::uint16_t) (((tm->tm_year - 80) << 9) | ((tm->tm_mon + 1) << 5) | tm->tm_mday);
+}
+
+// deflate entries[i] into parts[i], run from the worker pool
+static void
+compressEntry(const std::vector<logaccess::BundleEntry>& entries,
+              const boost::filesystem::path& out,
+              std::vector<Part>& parts, unsigned int i) {
+    const logaccess::BundleEntry& entry = entries[i];
+    Part& part = parts[i];
+    logaccess::File in;
+    if (!in.open(entry.file)) {
+        part.error = std::string("unable to open ") + entry.file.string();
+        return;
+    }
+    std::time_t mtime = std::time(NULL);
+    try {
+        mtime = boost::filesystem::last_write_time(entry.file);
+    } catch (const boost::filesystem::filesystem_error& /*e*/) {
+    }
+    dosTimestamp(mtime, part.dosTime, part.dosDate);
+
+    std::ostringstream ss;
+    ss << out.filename().string() << "." << i << ".part";
+    part.path = out.parent_path() / ss.str();
+    boost::filesystem::ofstream os(part.path, std::ios::binary | std::ios::trunc);
+    if (!os) {
+        part.error = std::string("unable to create ") + part.path.string();
+        return;
+    }
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    // raw deflate, zip supplies its own framing
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        part.error = "unable to initialize compression";
+        return;
+    }
+    std::vector<char> inBuf(kChunkSize), outBuf(kChunkSize);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    int flush = Z_NO_FLUSH;
+    while (flush != Z_FINISH) {
+        long long n = in.readAt(part.size, &inBuf[0], inBuf.size());
+        if (n < 0) {
+            part.error = std::string("unable to read ") + entry.file.string();
+            break;
+        }
+        crc = crc32(crc, (const Bytef*) &inBuf[0], (uInt) n);
+        part.size += n;
+        flush = (n == 0) ? Z_FINISH : Z_NO_FLUSH;
+        zs.next_in = (Bytef*) &inBuf[0];
+        zs.avail_in = (uInt) n;
+        do {
+            zs.next_out = (Bytef*) &outBuf[0];
+            zs.avail_out = (uInt) outBuf.size();
+            deflate(&zs, flush);
+            std::size_t have = outBuf.size() - zs.avail_out;
+            os.write(&outBuf[0], have);
+            part.compressedSize += have;
+        } while (zs.avail_out == 0);
+    }
+    deflateEnd(&zs);
+    part.crc = (boost::uint32_t) crc;
+    if (part.error.empty() && !os) {
+        part.error = std::string("unable to write ") + part.path.string();
+    }
+    if (part.error.empty() && (part.size > kMaxZipSize || part.compressedSize > kMaxZipSize)) {
+        part.error = entry.file.string() + " is too large to bundle";
+    }
+}
+
+// append part's data to os
+static bool
+appendPart(const Part& part, boost::filesystem::ofstream& os) {
+    boost::filesystem::ifstream is(part.path, std::ios::binary);
+    if (!is) {
+        return false;
+    }
+    std::vector<char> buf(kChunkSize);
+    while (is) {
+        is.read(&buf[0], buf.size());
+        os.write(&buf[0], is.gcount());
+    }
+    return !!os;
+}
+
+std::string
+logaccess::writeBundle(const std::vector<BundleEntry>& entries,
+                       const boost::filesystem::path& out, BundleStats& stats) {
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    if (entries.size() > kMaxZipEntries) {
+        return std::string("too many files to bundle");
+    }
+    std::vector<Part> parts(entries.size());
+    PartFiles partFiles(parts);
+    logaccess::pool::parallelFor(entries.size(),
+                                 boost::bind(compressEntry, boost::cref(entries),
+                                             boost::cref(out), boost::ref(parts), _1));
+    std::string error;
+    for (std::vector<Part>::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+        if (error.empty() && !it->error.empty()) {
+            error = it->error;
+        }
+    }
+    boost::filesystem::ofstream os;
+    if (error.empty()) {
+        os.open(out, std::ios::binary | std::ios::trunc);
+        if (!os) {
+            error = std::string("unable to create ") + out.string();
+        }
+    }
+    Header central;
+    boost::uint64_t offset = 0;
+    for (std::size_t i = 0; error.empty() && i < parts.size(); i++) {
+        const Part& part = parts[i];
+        const std::string& name = entries[i].name;
+        Header local;
+        local.u32(0x04034b50);
+        local.u16(20);                  // version needed, 2.0 for deflate
+        local.u16(0);                   // flags
+        local.u16(8);                   // deflate
+        local.u16(part.dosTime);
+        local.u16(part.dosDate);
+        local.u32(part.crc);
+        local.u32((boost::uint32_t) part.compressedSize);
+        local.u32((boost::uint32_t) part.size);
+        local.u16((boost::uint16_t) name.size());
+        local.u16(0);                   // no extra field
+        local.bytes(name);
+        if (offset > kMaxZipSize) {
+            error = "bundle is too large";
+            break;
+        }
+        central.u32(0x02014b50);
+        central.u16(20);                // made by
+        central.u16(20);
+        central.u16(0);
+        central.u16(8);
+        central.u16(part.dosTime);
+        central.u16(part.dosDate);
+        central.u32(part.crc);
+        central.u32((boost::uint32_t) part.compressedSize);
+        central.u32((boost::uint32_t) part.size);
+        central.u16((boost::uint16_t) name.size());
+        central.u16(0);                 // extra
+        central.u16(0);                 // comment
+        central.u16(0);                 // disk
+        central.u16(0);                 // internal attributes
+        central.u32(0);                 // external attributes
+        central.u32((boost::uint32_t) offset);
+        central.bytes(name);
+
+        os.write(local.str().data(), local.str().size());
+        if (!appendPart(part, os)) {
+            error = std::string("unable to write ") + out.string();
+            break;
+        }
+        offset += local.str().size() + part.compressedSize;
+        stats.files++;
+        stats.originalSize += part.size;
+    }
+    if (error.empty()) {
+        Header end;
+        end.u32(0x06054b50);
+        end.u16(0);                     // this disk
+        end.u16(0);                     // disk with central directory
+        end.u16((boost::uint16_t) parts.size());
+        end.u16((boost::uint16_t) parts.size());
+        end.u32((boost::uint32_t) central.str().size());
+        end.u32((boost::uint32_t) offset);
+        end.u16(0);                     // comment
+        os.write(central.str().data(), central.str().size());
+        os.write(end.str().data(), end.str().size());
+        os.close();
+        if (!os || offset + central.str().size() > kMaxZipSize) {
+            error = std::string("unable to write ") + out.string();
+        }
+        stats.compressedSize = offset + central.str().size() + end.str().size();
+    }
+    if (!error.empty()) {
+        if (os.is_open()) {
+            os.close();
+        }
+        boost::system::error_code ec;
+        boost::filesystem::remove(out, ec);
+    }
+    stats.elapsedMs = (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds();
+    return error;
+}
@@ -0,0 +1,57 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_BUNDLE_H__
+#define __LOGACCESS_BUNDLE_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct BundleEntry {
+    // the file to add
+    boost::filesystem::path file;
+    // its name inside the bundle, '/' separated
+    std::string name;
+};
+
+struct BundleStats {
+    BundleStats() : files(0), originalSize(0), compressedSize(0), elapsedMs(0) {}
+    unsigned int files;
+    boost::uint64_t originalSize;
+    boost::uint64_t compressedSize;
+    boost::uint64_t elapsedMs;
+};
+
+// write entries into a zip archive at out.  each file is deflated by
+// its own worker into a part file next to out, reading and writing in
+// fixed size chunks, and the parts are then stitched together.  memory
+// use doesn't depend on the size of the files.
+std::string writeBundle(const std::vector<BundleEntry>& entries,
+                        const boost::filesystem::path& out, BundleStats& stats);
+
+}
+
+#endif
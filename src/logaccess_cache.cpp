@@ -0,0 +1,219 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_cache.h"
+#include "logaccess_stats.h"
+#include "logaccess_util.h"
+#include <algorithm>
+
+using logaccess::LogDirCache;
+
+LogDirCache::LogDirCache() : m_haveRoots(false) {
+}
+
+LogDirCache::LogDirCache(const logaccess::util::Roots& roots)
+    : m_haveRoots(true), m_roots(roots) {
+}
+
+LogDirCache::~LogDirCache() {
+}
+
+std::string
+LogDirCache::getLogfilePaths(bplus::List& paths) {
+    return getServiceLogfilePaths(std::string(), paths);
+}
+
+std::string
+LogDirCache::getServiceLogfilePaths(const std::string& service, bplus::List& paths) {
+    return getLogfiles(service, false, paths);
+}
+
+std::string
+LogDirCache::getLogfileDetails(const std::string& service, bplus::List& files) {
+    return getLogfiles(service, true, files);
+}
+
+std::string
+LogDirCache::getLogfiles(const std::string& service, bool details, bplus::List& out) {
+    boost::filesystem::path logDir;
+    std::string error = lookup(service, logDir);
+    if (!error.empty() || logDir.empty()) {
+        return error;
+    }
+    bplus::List found;
+    error = list(service, logDir, details, found);
+    if (!error.empty()) {
+        // the directory went away between the change check and the
+        // listing.  start over from scratch, once.
+        forget(service);
+        error = lookup(service, logDir);
+        if (!error.empty() || logDir.empty()) {
+            return error;
+        }
+        return list(service, logDir, details, out);
+    }
+    for (unsigned int i = 0; i < found.size(); i++) {
+        out.append(found.value(i)->clone());
+    }
+    return std::string();
+}
+
+std::string
+LogDirCache::list(const std::string& service, const boost::filesystem::path& logDir,
+                  bool details, bplus::List& out) {
+    if (!details) {
+        return logaccess::util::listLogFiles(logDir, out);
+    }
+    // lookup() has resolved the roots already
+    logaccess::util::Roots roots;
+    std::string error = resolveRoots(roots);
+    if (!error.empty()) {
+        return error;
+    }
+    return logaccess::util::listLogFiles(logDir, logaccess::util::logComponent(roots, service, logDir),
+                                         out);
+}
+
+std::string
+LogDirCache::lookup(const std::string& service, boost::filesystem::path& logDir) {
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        Entry& entry = service.empty() ? m_platform : m_services[service];
+        if (entry.watcher && !entry.watcher->changed()) {
+            logaccess::stats::count(logaccess::stats::kCacheHits);
+            logDir = entry.logDir;
+            return std::string();
+        }
+    }
+    logaccess::stats::count(logaccess::stats::kCacheMisses);
+    // discovery runs unlocked, other services needn't wait on it.  if two
+    // threads race on the same service both answers are equally good.
+    Entry found;
+    std::string error = discover(service, found);
+    logDir = found.logDir;
+    if (!error.empty() || logDir.empty()) {
+        // failures and services without data aren't remembered, they're
+        // cheap to rediscover and likely to change
+        forget(service);
+        return error;
+    }
+    boost::mutex::scoped_lock lock(m_lock);
+    if (service.empty()) {
+        m_platform = found;
+    } else {
+        m_services[service] = found;
+    }
+    return error;
+}
+
+// times discovery is repeated while the directories it looks at keep
+// changing under it, after which the answer is used but not cached
+static const unsigned int kDiscoverTries = 3;
+
+// one discovery pass, visited comes back sorted
+static std::string
+scan(const logaccess::util::Roots& roots, const std::string& service,
+     boost::filesystem::path& logDir, std::vector<boost::filesystem::path>& visited) {
+    logDir.clear();
+    visited.clear();
+    std::string error;
+    if (service.empty()) {
+        error = logaccess::util::findLogDir(roots, logDir, visited);
+    } else {
+        error = logaccess::util::findServiceLogDir(roots, service, logDir, visited);
+    }
+    std::sort(visited.begin(), visited.end());
+    return error;
+}
+
+std::string
+LogDirCache::discover(const std::string& service, Entry& entry) {
+    entry.logDir.clear();
+    entry.watcher.reset();
+    logaccess::util::Roots roots;
+    std::string error = resolveRoots(roots);
+    if (!error.empty()) {
+        return error;
+    }
+    // which directories to watch is only known once they've been
+    // scanned, and a change between scanning one and watching it would
+    // go unseen.  so scan again once watching: finding the same means
+    // the watches cover what the answer came from.
+    std::vector<boost::filesystem::path> visited;
+    error = scan(roots, service, entry.logDir, visited);
+    for (unsigned int tries = 1; ; tries++) {
+        if (!error.empty() || entry.logDir.empty()) {
+            return error;
+        }
+        boost::shared_ptr<DirWatcher> watcher(new DirWatcher);
+        for (std::vector<boost::filesystem::path>::const_iterator it = visited.begin(); it != visited.end(); ++it) {
+            if (!watcher->add(*it)) {
+                // can't watch it, so can't cache it.  the answer is still good
+                // for this request.
+                return std::string();
+            }
+        }
+        boost::filesystem::path again;
+        std::vector<boost::filesystem::path> againVisited;
+        error = scan(roots, service, again, againVisited);
+        if (error.empty() && again == entry.logDir && againVisited == visited
+            && !watcher->changed()) {
+            entry.watcher = watcher;
+            return std::string();
+        }
+        entry.logDir = again;
+        if (tries == kDiscoverTries) {
+            // still changing, answer from the latest scan uncached
+            return error;
+        }
+        visited.swap(againVisited);
+    }
+}
+
+std::string
+LogDirCache::resolveRoots(logaccess::util::Roots& roots) {
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        if (m_haveRoots) {
+            roots = m_roots;
+            return std::string();
+        }
+    }
+    // the platform calls behind this can be slow, don't hold the lock
+    std::string error = logaccess::util::getRoots(roots);
+    if (error.empty()) {
+        boost::mutex::scoped_lock lock(m_lock);
+        m_roots = roots;
+        m_haveRoots = true;
+    }
+    return error;
+}
+
+void
+LogDirCache::forget(const std::string& service) {
+    boost::mutex::scoped_lock lock(m_lock);
+    if (service.empty()) {
+        m_platform = Entry();
+    } else {
+        m_services.erase(service);
+    }
+}
@@ -0,0 +1,90 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_CACHE_H__
+#define __LOGACCESS_CACHE_H__
+
+#include "bputil/bptypeutil.h"
+#include "logaccess_util.h"
+#include "logaccess_watch.h"
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <map>
+#include <string>
+
+namespace logaccess {
+
+// Remembers where the platform and service logfiles live so that
+// repeated requests only have to list the log directory rather than
+// rediscover it.  An entry is dropped as soon as any directory that was
+// examined to produce it changes.  Safe to use from several threads,
+// discovery for different services runs concurrently.
+class LogDirCache : boost::noncopyable {
+public:
+    // the roots of the current user are looked up by the first
+    // discovery, later ones reuse them
+    LogDirCache();
+    // discover below roots only
+    explicit LogDirCache(const util::Roots& roots);
+    ~LogDirCache();
+
+    // same contract as logaccess::util::getLogfilePaths()
+    std::string getLogfilePaths(bplus::List& paths);
+
+    // same contract as logaccess::util::getServiceLogfilePaths()
+    std::string getServiceLogfilePaths(const std::string& service, bplus::List& paths);
+
+    // as getServiceLogfilePaths() (the platform's logs if service is
+    // empty), listing each file as a map of its details (see
+    // logaccess::util::listLogFiles())
+    std::string getLogfileDetails(const std::string& service, bplus::List& files);
+
+private:
+    struct Entry {
+        boost::filesystem::path logDir;
+        boost::shared_ptr<DirWatcher> watcher;
+    };
+
+    // find the log dir for service (platform if empty), from cache if
+    // we can.  logDir is empty on success if there's nothing to list.
+    std::string lookup(const std::string& service, boost::filesystem::path& logDir);
+    // list the logfiles of service found in logDir
+    std::string list(const std::string& service, const boost::filesystem::path& logDir,
+                     bool details, bplus::List& out);
+    std::string getLogfiles(const std::string& service, bool details, bplus::List& out);
+    std::string discover(const std::string& service, Entry& entry);
+    std::string resolveRoots(util::Roots& roots);
+    void forget(const std::string& service);
+
+    bool m_haveRoots;
+    util::Roots m_roots;
+
+    boost::mutex m_lock;
+    Entry m_platform;
+    std::map<std::string, Entry> m_services;
+};
+
+}
+
+#endif
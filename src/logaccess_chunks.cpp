@@ -0,0 +1,224 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_chunks.h"
+#include "logaccess_sha1.h"
+#include "logaccess_stats.h"
+#include <algorithm>
+#include <ctime>
+
+using logaccess::Chunk;
+using logaccess::ChunkCache;
+using logaccess::ChunkList;
+using logaccess::FetchedChunk;
+using logaccess::Manifest;
+
+const boost::uint64_t ChunkList::kMinChunk;
+const boost::uint64_t ChunkList::kAverageChunk;
+const boost::uint64_t ChunkList::kMaxChunk;
+
+// how much is read at a time while chunking
+static const std::size_t kReadSize = 256 * 1024;
+
+// a cut comes where the top kCutBits bits of the hash are clear, once
+// every 2^kCutBits (kAverageChunk - kMinChunk) bytes past the minimum
+// on average.  the top bits depend on the last 64 bytes, the low ones
+// on only the last few.
+static const unsigned int kCutBits = 13;
+static const boost::uint64_t kCutMask = ~(~0ULL >> kCutBits);
+
+// a random value per byte for the gear hash.  fixed, so chunks (and
+// the digests callers hold) are the same from one run to the next.
+static boost::uint64_t s_gear[256];
+
+static bool
+fillGear() {
+    // splitmix64
+    boost::uint64_t x = 0;
+    for (int i = 0; i < 256; i++) {
+        x += 0x9E3779B97F4A7C15ULL;
+        boost::uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        s_gear[i] = z ^ (z >> 31);
+    }
+    return true;
+}
+
+static const bool s_gearFilled = fillGear();
+
+ChunkList::ChunkList() : m_size(0), m_lastCut(true) {
+}
+
+bool
+ChunkList::update(const File& file, const FileId& id, boost::uint64_t size) {
+    if (id != m_id || size < m_size) {
+        // rotated or truncated, what we knew is worthless
+        m_id = id;
+        m_size = 0;
+        m_chunks.clear();
+        m_lastCut = true;
+    }
+    if (size == m_size) {
+        return true;
+    }
+    // a last chunk ended by the end of the file may now run further
+    if (!m_lastCut) {
+        m_chunks.pop_back();
+        m_lastCut = true;
+    }
+    boost::uint64_t start = m_chunks.empty() ? 0 : m_chunks.back().offset + m_chunks.back().length;
+    boost::uint64_t pos = start;
+    boost::uint64_t hash = 0;
+    Sha1 sha;
+    std::string buf;
+    while (pos < size) {
+        std::size_t want = (std::size_t) std::min<boost::uint64_t>(kReadSize, size - pos);
+        if (!file.read(pos, want, buf)) {
+            return false;
+        }
+        if (buf.empty()) {
+            // shrank while we read, try again next time
+            size = pos;
+            break;
+        }
+        const unsigned char* p = (const unsigned char*) buf.data();
+        std::size_t n = buf.size();
+        std::size_t hashed = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            boost::uint64_t len = pos + i + 1 - start;
+            if (len <= kMinChunk) {
+                continue;
+            }
+            hash = (hash << 1) + s_gear[p[i]];
+            if ((hash & kCutMask) != 0 && len < kMaxChunk) {
+                continue;
+            }
+            sha.update(buf.data() + hashed, i + 1 - hashed);
+            hashed = i + 1;
+            Chunk c;
+            c.offset = start;
+            c.length = len;
+            c.digest = sha.hexDigest();
+            m_chunks.push_back(c);
+            start = pos + i + 1;
+            hash = 0;
+        }
+        sha.update(buf.data() + hashed, n - hashed);
+        pos += n;
+    }
+    if (pos > start) {
+        Chunk c;
+        c.offset = start;
+        c.length = pos - start;
+        c.digest = sha.hexDigest();
+        m_chunks.push_back(c);
+        m_lastCut = false;
+    }
+    m_size = size;
+    return true;
+}
+
+std::string
+ChunkCache::manifest(const boost::filesystem::path& path, Manifest& manifest) {
+    File file;
+    FileId id;
+    boost::uint64_t size = 0;
+    if (!file.open(path) || !file.id(id) || !file.size(size)) {
+        return std::string("unable to open ") + path.string();
+    }
+    boost::system::error_code ec;
+    std::time_t modified = boost::filesystem::last_write_time(path, ec);
+    manifest.modified = ec ? 0 : (boost::int64_t) modified * 1000;
+    boost::shared_ptr<Entry> entry;
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        boost::shared_ptr<Entry>& e = m_lists[path];
+        logaccess::stats::count(e ? logaccess::stats::kCacheHits
+                                  : logaccess::stats::kCacheMisses);
+        if (!e) {
+            e.reset(new Entry);
+        }
+        entry = e;
+    }
+    boost::mutex::scoped_lock entryLock(entry->lock);
+    if (!entry->list.update(file, id, size)) {
+        boost::mutex::scoped_lock lock(m_lock);
+        std::map<boost::filesystem::path, boost::shared_ptr<Entry> >::iterator it = m_lists.find(path);
+        if (it != m_lists.end() && it->second == entry) {
+            m_lists.erase(it);
+        }
+        return std::string("unable to read ") + path.string();
+    }
+    const std::vector<Chunk>& chunks = entry->list.chunks();
+    manifest.chunks = chunks;
+    manifest.size = chunks.empty() ? 0 : chunks.back().offset + chunks.back().length;
+    return std::string();
+}
+
+std::string
+ChunkCache::fetch(const boost::filesystem::path& path, const std::set<std::string>& have,
+                  std::size_t maxBytes, std::vector<FetchedChunk>& out, bool& truncated) {
+    Manifest m;
+    std::string error = manifest(path, m);
+    if (!error.empty()) {
+        return error;
+    }
+    std::size_t used = 0;
+    std::set<std::string> sent;
+    for (std::vector<FetchedChunk>::const_iterator it = out.begin(); it != out.end(); ++it) {
+        used += it->data.size();
+        sent.insert(it->chunk.digest);
+    }
+    File file;
+    if (!file.open(path)) {
+        return std::string("unable to open ") + path.string();
+    }
+    Sha1 sha;
+    for (std::vector<Chunk>::const_iterator c = m.chunks.begin(); c != m.chunks.end(); ++c) {
+        if (have.count(c->digest) || sent.count(c->digest)) {
+            continue;
+        }
+        // always send one, a chunk bigger than maxBytes would
+        // otherwise never be sent and the caller never finish
+        if (used + c->length > maxBytes && !out.empty()) {
+            truncated = true;
+            return std::string();
+        }
+        FetchedChunk f;
+        f.chunk = *c;
+        if (!file.read(c->offset, (std::size_t) c->length, f.data)) {
+            return std::string("unable to read ") + path.string();
+        }
+        sha.update(f.data.data(), f.data.size());
+        if (sha.hexDigest() != c->digest) {
+            // rewritten in place rather than appended to, start over
+            boost::mutex::scoped_lock lock(m_lock);
+            m_lists.erase(path);
+            return path.string() + " changed while reading, fetch a new manifest";
+        }
+        used += f.data.size();
+        sent.insert(c->digest);
+        out.push_back(f);
+    }
+    return std::string();
+}
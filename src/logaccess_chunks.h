@@ -0,0 +1,116 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_CHUNKS_H__
+#define __LOGACCESS_CHUNKS_H__
+
+#include "logaccess_file.h"
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct Chunk {
+    boost::uint64_t offset;
+    boost::uint64_t length;
+    // SHA-1 of the chunk, in hex
+    std::string digest;
+};
+
+// A logfile cut into chunks where a rolling (gear) hash of the bytes
+// before a point matches, so a cut depends only on what's near it and
+// appending to the file leaves every chunk but the last one alone.
+// Chunks are between kMinChunk and kMaxChunk bytes, kAverageChunk on
+// average.
+class ChunkList {
+public:
+    static const boost::uint64_t kMinChunk = 8 * 1024;
+    static const boost::uint64_t kAverageChunk = 16 * 1024;
+    static const boost::uint64_t kMaxChunk = 64 * 1024;
+
+    ChunkList();
+
+    // bring the chunks up to date with file (whose id and size are
+    // given).  a file that has grown is hashed from the start of its
+    // last chunk, one that's been replaced or truncated from scratch.
+    bool update(const File& file, const FileId& id, boost::uint64_t size);
+
+    const std::vector<Chunk>& chunks() const { return m_chunks; }
+
+private:
+    FileId m_id;
+    boost::uint64_t m_size;
+    std::vector<Chunk> m_chunks;
+    // whether the last chunk was cut by the hash rather than by the end
+    // of the file
+    bool m_lastCut;
+};
+
+struct Manifest {
+    Manifest() : size(0), modified(0) {}
+    boost::uint64_t size;
+    // milliseconds since 1970 (UTC)
+    boost::int64_t modified;
+    std::vector<Chunk> chunks;
+};
+
+struct FetchedChunk {
+    Chunk chunk;
+    std::string data;
+};
+
+// ChunkLists of the logfiles manifests have been asked for, built on
+// first use and kept for the life of the service instance.
+class ChunkCache : boost::noncopyable {
+public:
+    // the size, modification time and chunks of path
+    std::string manifest(const boost::filesystem::path& path, Manifest& manifest);
+
+    // append the chunks of path whose digests aren't in have to out,
+    // skipping any whose digests are already there.  stops, setting
+    // truncated, before out's data would exceed maxBytes, though the
+    // first chunk is added to an empty out whatever its size.
+    std::string fetch(const boost::filesystem::path& path, const std::set<std::string>& have,
+                      std::size_t maxBytes, std::vector<FetchedChunk>& out, bool& truncated);
+
+private:
+    // one log's chunks.  its lock is held while they're hashed, m_lock
+    // only while finding it, so other logs can be hashed meanwhile.
+    struct Entry {
+        boost::mutex lock;
+        ChunkList list;
+    };
+
+    boost::mutex m_lock;
+    std::map<boost::filesystem::path, boost::shared_ptr<Entry> > m_lists;
+};
+
+}
+
+#endif
@@ -0,0 +1,417 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_columns.h"
+#include "logaccess_stats.h"
+#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+using logaccess::ColumnCache;
+using logaccess::ColumnMatch;
+using logaccess::ColumnQuery;
+using logaccess::LogColumns;
+
+// how much of a log is parsed at a time
+static const std::size_t kParseChunk = 256 * 1024;
+
+// longest message handed back for a match
+static const std::size_t kMaxMessage = 4096;
+
+// bump when the persisted layout changes
+static const char kColumnsMagic[8] = { 'L', 'A', 'C', 'O', 'L', 'S', '0', '3' };
+
+// how much of each end of the parsed part of a log is hashed to check
+// it's still the same log
+static const std::size_t kCheckBytes = 4096;
+
+static const boost::uint32_t kNoName = 0xffffffff;
+
+ColumnQuery::ColumnQuery()
+    : minLevel(kLevelUnknown),
+      from(std::numeric_limits<boost::int64_t>::min()),
+      to(std::numeric_limits<boost::int64_t>::max()) {
+}
+
+const boost::uint64_t ColumnCache::kPersistBytes;
+
+LogColumns::LogColumns() : m_parsed(0), m_check(0), m_dirty(false), m_unsaved(0) {
+}
+
+void
+LogColumns::clear() {
+    m_parsed = 0;
+    m_check = 0;
+    m_times.clear();
+    m_levels.clear();
+    m_threads.clear();
+    m_categories.clear();
+    m_offsets.clear();
+    m_messages.clear();
+    m_names.clear();
+    m_nameIds.clear();
+}
+
+boost::uint32_t
+LogColumns::intern(const char* s, std::size_t len) {
+    if (!s || len == 0) {
+        return kNoName;
+    }
+    std::string name(s, len);
+    std::map<std::string, boost::uint32_t>::const_iterator it = m_nameIds.find(name);
+    if (it != m_nameIds.end()) {
+        return it->second;
+    }
+    boost::uint32_t id = (boost::uint32_t) m_names.size();
+    m_names.push_back(name);
+    m_nameIds[name] = id;
+    return id;
+}
+
+// FNV-1a of the first and last kCheckBytes of file's first parsed bytes
+static bool
+prefixCheck(const logaccess::File& file, boost::uint64_t parsed, boost::uint64_t& check) {
+    std::string head, tail;
+    std::size_t n = (std::size_t) std::min<boost::uint64_t>(parsed, kCheckBytes);
+    if (!file.read(0, n, head) || !file.read(parsed - n, n, tail)) {
+        return false;
+    }
+    head += tail;
+    check = 14695981039346656037ULL;
+    for (std::string::const_iterator it = head.begin(); it != head.end(); ++it) {
+        check = (check ^ (unsigned char) *it) * 1099511628211ULL;
+    }
+    return true;
+}
+
+bool
+LogColumns::update(const File& file, const FileId& id, boost::uint64_t size, bool& changed) {
+    changed = false;
+    boost::uint64_t check = 0;
+    if (id == m_id && size >= m_parsed && m_parsed > 0
+        && !prefixCheck(file, m_parsed, check)) {
+        return false;
+    }
+    if (id != m_id || size < m_parsed || check != m_check) {
+        // replaced, truncated or rewritten, what we knew is worthless
+        clear();
+        m_id = id;
+        changed = true;
+    }
+    boost::uint64_t parsed = m_parsed;
+    std::string chunk;
+    while (m_parsed < size) {
+        if (!file.read(m_parsed, kParseChunk, chunk)) {
+            return false;
+        }
+        // only whole lines, a partial last line waits for the next update
+        std::string::size_type last = chunk.rfind('\n');
+        if (last == std::string::npos) {
+            if (chunk.size() < kParseChunk) {
+                break;
+            }
+            // a single enormous line, take it as is
+            last = chunk.size() - 1;
+        }
+        const char* base = chunk.data();
+        const char* end = base + last + 1;
+        for (const char* p = base; p < end; ) {
+            const char* nl = (const char*) memchr(p, '\n', end - p);
+            const char* eol = nl ? nl + 1 : end;
+            LineFields f;
+            if (parseLine(p, eol, f)) {
+                m_times.push_back(f.time);
+                m_levels.push_back((boost::uint8_t) f.level);
+                m_threads.push_back(intern(f.thread, f.threadLen));
+                m_categories.push_back(intern(f.category, f.categoryLen));
+                m_offsets.push_back(m_parsed + (p - base));
+                std::size_t msg = f.message - p;
+                m_messages.push_back((boost::uint32_t) std::min<std::size_t>(msg, 0xffffffff));
+                changed = true;
+            }
+            p = eol;
+        }
+        m_parsed += last + 1;
+    }
+    if (m_parsed != parsed) {
+        if (!prefixCheck(file, m_parsed, m_check)) {
+            return false;
+        }
+        m_unsaved += m_parsed - parsed;
+    }
+    m_dirty = m_dirty || changed || m_parsed != parsed;
+    return true;
+}
+
+// names matching any of wanted, as a lookup table by id
+static std::vector<bool>
+nameMask(const std::vector<std::string>& names, const std::set<std::string>& wanted) {
+    std::vector<bool> mask(names.size(), false);
+    for (std::size_t i = 0; i < names.size(); i++) {
+        mask[i] = wanted.count(names[i]) > 0;
+    }
+    return mask;
+}
+
+boost::uint64_t
+LogColumns::filter(const ColumnQuery& q, const File& file, std::size_t max,
+                   std::vector<ColumnMatch>& matches) const {
+    std::vector<bool> categories = nameMask(m_names, q.categories);
+    std::vector<bool> threads = nameMask(m_names, q.threads);
+    const bool anyCategory = q.categories.empty();
+    const bool anyThread = q.threads.empty();
+    const boost::uint8_t minLevel = (boost::uint8_t) q.minLevel;
+    boost::uint64_t count = 0;
+    const std::size_t rows = m_times.size();
+    for (std::size_t i = 0; i < rows; i++) {
+        if (m_levels[i] < minLevel || m_times[i] < q.from || m_times[i] > q.to) {
+            continue;
+        }
+        if (!anyCategory && (m_categories[i] == kNoName || !categories[m_categories[i]])) {
+            continue;
+        }
+        if (!anyThread && (m_threads[i] == kNoName || !threads[m_threads[i]])) {
+            continue;
+        }
+        count++;
+        if (matches.size() >= max) {
+            continue;
+        }
+        ColumnMatch m;
+        m.offset = m_offsets[i];
+        m.time = m_times[i];
+        m.level = (LogLevel) m_levels[i];
+        if (m_threads[i] != kNoName) {
+            m.thread = m_names[m_threads[i]];
+        }
+        if (m_categories[i] != kNoName) {
+            m.category = m_names[m_categories[i]];
+        }
+        boost::uint64_t end = (i + 1 < rows) ? m_offsets[i + 1] : m_parsed;
+        boost::uint64_t start = m_offsets[i] + m_messages[i];
+        if (start < end) {
+            std::size_t len = (std::size_t) std::min<boost::uint64_t>(end - start, kMaxMessage);
+            file.read(start, len, m.message);
+            while (!m.message.empty() && (m.message[m.message.size() - 1] == '\n'
+                                          || m.message[m.message.size() - 1] == '\r')) {
+                m.message.erase(m.message.size() - 1);
+            }
+        }
+        matches.push_back(m);
+    }
+    return count;
+}
+
+template <class T> static void
+writeColumn(std::ostream& os, const std::vector<T>& v) {
+    boost::uint64_t n = v.size();
+    os.write((const char*) &n, sizeof(n));
+    if (n > 0) {
+        os.write((const char*) &v[0], n * sizeof(T));
+    }
+}
+
+template <class T> static bool
+readColumn(std::istream& is, std::vector<T>& v) {
+    boost::uint64_t n = 0;
+    if (!is.read((char*) &n, sizeof(n)) || n > (1ULL << 32)) {
+        return false;
+    }
+    v.resize((std::size_t) n);
+    return n == 0 || !!is.read((char*) &v[0], n * sizeof(T));
+}
+
+bool
+LogColumns::save(const boost::filesystem::path& path) {
+    // written aside and renamed into place, so a reader never sees half
+    boost::filesystem::path tmp = path;
+    tmp.replace_extension(".tmp");
+    {
+        boost::filesystem::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os) {
+            return false;
+        }
+        os.write(kColumnsMagic, sizeof(kColumnsMagic));
+        os.write((const char*) &m_id.volume, sizeof(m_id.volume));
+        os.write((const char*) &m_id.index, sizeof(m_id.index));
+        os.write((const char*) &m_parsed, sizeof(m_parsed));
+        os.write((const char*) &m_check, sizeof(m_check));
+        boost::uint64_t n = m_names.size();
+        os.write((const char*) &n, sizeof(n));
+        for (std::vector<std::string>::const_iterator it = m_names.begin(); it != m_names.end(); ++it) {
+            boost::uint32_t len = (boost::uint32_t) it->size();
+            os.write((const char*) &len, sizeof(len));
+            os.write(it->data(), len);
+        }
+        writeColumn(os, m_times);
+        writeColumn(os, m_levels);
+        writeColumn(os, m_threads);
+        writeColumn(os, m_categories);
+        writeColumn(os, m_offsets);
+        writeColumn(os, m_messages);
+        if (!os) {
+            return false;
+        }
+    }
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        return false;
+    }
+    m_dirty = false;
+    m_unsaved = 0;
+    return true;
+}
+
+bool
+LogColumns::load(const boost::filesystem::path& path) {
+    clear();
+    boost::filesystem::ifstream is(path, std::ios::binary);
+    char magic[sizeof(kColumnsMagic)];
+    if (!is || !is.read(magic, sizeof(magic)) || memcmp(magic, kColumnsMagic, sizeof(magic))) {
+        return false;
+    }
+    boost::uint64_t n = 0;
+    is.read((char*) &m_id.volume, sizeof(m_id.volume));
+    is.read((char*) &m_id.index, sizeof(m_id.index));
+    is.read((char*) &m_parsed, sizeof(m_parsed));
+    is.read((char*) &m_check, sizeof(m_check));
+    is.read((char*) &n, sizeof(n));
+    for (boost::uint64_t i = 0; is && i < n; i++) {
+        boost::uint32_t len = 0;
+        if (!is.read((char*) &len, sizeof(len)) || len > 0xffff) {
+            break;
+        }
+        std::string name(len, '\0');
+        if (len > 0) {
+            is.read(&name[0], len);
+        }
+        m_nameIds[name] = (boost::uint32_t) m_names.size();
+        m_names.push_back(name);
+    }
+    bool ok = is && readColumn(is, m_times) && readColumn(is, m_levels)
+        && readColumn(is, m_threads) && readColumn(is, m_categories)
+        && readColumn(is, m_offsets) && readColumn(is, m_messages);
+    std::size_t rows = m_times.size();
+    ok = ok && m_levels.size() == rows && m_threads.size() == rows
+        && m_categories.size() == rows && m_offsets.size() == rows
+        && m_messages.size() == rows;
+    for (std::size_t i = 0; ok && i < rows; i++) {
+        ok = (m_threads[i] == kNoName || m_threads[i] < m_names.size())
+            && (m_categories[i] == kNoName || m_categories[i] < m_names.size());
+    }
+    if (!ok) {
+        clear();
+    }
+    m_dirty = false;
+    m_unsaved = 0;
+    return ok;
+}
+
+ColumnCache::~ColumnCache() {
+    if (m_dir.empty()) {
+        return;
+    }
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(m_dir, ec);
+    std::map<boost::filesystem::path, boost::shared_ptr<Entry> >::iterator it;
+    for (it = m_columns.begin(); it != m_columns.end(); ++it) {
+        if (it->second->columns.dirty()) {
+            it->second->columns.save(persistPath(it->first));
+        }
+    }
+}
+
+void
+ColumnCache::setDir(const boost::filesystem::path& dir) {
+    boost::mutex::scoped_lock lock(m_lock);
+    m_dir = dir;
+}
+
+boost::filesystem::path
+ColumnCache::persistPath(const boost::filesystem::path& path) const {
+    // FNV-1a of the log's path names its columns
+    std::string s = path.string();
+    boost::uint64_t h = 14695981039346656037ULL;
+    for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+        h = (h ^ (unsigned char) *it) * 1099511628211ULL;
+    }
+    std::ostringstream ss;
+    ss << std::hex << h << ".columns";
+    return m_dir / ss.str();
+}
+
+std::string
+ColumnCache::query(const boost::filesystem::path& path, const ColumnQuery& q,
+                   std::size_t max, std::vector<ColumnMatch>& matches,
+                   boost::uint64_t& count) {
+    File file;
+    FileId id;
+    boost::uint64_t size = 0;
+    if (!file.open(path) || !file.id(id) || !file.size(size)) {
+        return std::string("unable to open ") + path.string();
+    }
+    boost::shared_ptr<Entry> entry;
+    boost::filesystem::path dir;
+    boost::filesystem::path persisted;
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        boost::shared_ptr<Entry>& e = m_columns[path];
+        if (!e) {
+            e.reset(new Entry);
+        }
+        entry = e;
+        dir = m_dir;
+        if (!m_dir.empty()) {
+            persisted = persistPath(path);
+        }
+    }
+    boost::mutex::scoped_lock entryLock(entry->lock);
+    LogColumns& columns = entry->columns;
+    if (!entry->loaded) {
+        entry->loaded = true;
+        // stale or damaged columns are simply rebuilt by update()
+        bool loaded = !persisted.empty() && columns.load(persisted);
+        logaccess::stats::count(loaded ? logaccess::stats::kCacheHits
+                                       : logaccess::stats::kCacheMisses);
+    } else {
+        logaccess::stats::count(logaccess::stats::kCacheHits);
+    }
+    bool changed = false;
+    if (!columns.update(file, id, size, changed)) {
+        boost::mutex::scoped_lock lock(m_lock);
+        std::map<boost::filesystem::path, boost::shared_ptr<Entry> >::iterator it = m_columns.find(path);
+        if (it != m_columns.end() && it->second == entry) {
+            m_columns.erase(it);
+        }
+        return std::string("unable to read ") + path.string();
+    }
+    if (!persisted.empty() && columns.unsaved() >= kPersistBytes) {
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(dir, ec);
+        columns.save(persisted);
+    }
+    count = columns.filter(q, file, max, matches);
+    return std::string();
+}
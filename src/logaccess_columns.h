@@ -0,0 +1,153 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_COLUMNS_H__
+#define __LOGACCESS_COLUMNS_H__
+
+#include "logaccess_file.h"
+#include "logaccess_line.h"
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct ColumnQuery {
+    ColumnQuery();
+    // lines at or above this level
+    LogLevel minLevel;
+    // lines in any of these categories / threads, any if empty
+    std::set<std::string> categories;
+    std::set<std::string> threads;
+    // lines logged in [from, to]
+    boost::int64_t from;
+    boost::int64_t to;
+};
+
+struct ColumnMatch {
+    boost::uint64_t offset;
+    boost::int64_t time;
+    LogLevel level;
+    std::string thread;
+    std::string category;
+    std::string message;
+};
+
+// A logfile parsed into columns: packed arrays of timestamps, levels,
+// interned thread and category ids and line offsets, one entry per
+// timestamped line (continuation lines belong to the line before).
+// Filtering walks the arrays, only matching lines are read back from
+// the file.
+class LogColumns {
+public:
+    LogColumns();
+
+    // parse what's been appended to file since the last update, or all of
+    // it if the file was replaced or truncated (or rewritten, which the
+    // ends of what was parsed no longer matching shows).  changed is set
+    // if any lines were added.
+    bool update(const File& file, const FileId& id, boost::uint64_t size, bool& changed);
+
+    bool load(const boost::filesystem::path& path);
+    bool save(const boost::filesystem::path& path);
+
+    // whether anything changed since the last load or save, and how many
+    // bytes of the log have been parsed since
+    bool dirty() const { return m_dirty; }
+    boost::uint64_t unsaved() const { return m_unsaved; }
+
+    // count the lines matching q, appending the first max of them
+    // (read back from file) to matches
+    boost::uint64_t filter(const ColumnQuery& q, const File& file, std::size_t max,
+                           std::vector<ColumnMatch>& matches) const;
+
+private:
+    boost::uint32_t intern(const char* s, std::size_t len);
+    void clear();
+
+    FileId m_id;
+    // bytes parsed, always a line boundary
+    boost::uint64_t m_parsed;
+    // hash of the first and last kCheckBytes of what was parsed, a file
+    // whose id and size look right but that doesn't match was rewritten
+    // (or is a rotated log's id reused)
+    boost::uint64_t m_check;
+    bool m_dirty;
+    boost::uint64_t m_unsaved;
+    std::vector<boost::int64_t> m_times;
+    std::vector<boost::uint8_t> m_levels;
+    std::vector<boost::uint32_t> m_threads;
+    std::vector<boost::uint32_t> m_categories;
+    std::vector<boost::uint64_t> m_offsets;
+    // where the message starts within its line
+    std::vector<boost::uint32_t> m_messages;
+    // interned thread and category names, id is the index
+    std::vector<std::string> m_names;
+    std::map<std::string, boost::uint32_t> m_nameIds;
+};
+
+// LogColumns of the logfiles that have been queried, kept for the life
+// of the service instance and persisted under a directory so they
+// survive it.  Columns are written out once kPersistBytes more of their
+// log has been parsed, rather than on every query that finds the log
+// grown, and when the cache goes away.
+class ColumnCache : boost::noncopyable {
+public:
+    static const boost::uint64_t kPersistBytes = 8 * 1024 * 1024;
+
+    ~ColumnCache();
+
+    // where columns are persisted, nothing is if never set
+    void setDir(const boost::filesystem::path& dir);
+
+    std::string query(const boost::filesystem::path& path, const ColumnQuery& q,
+                      std::size_t max, std::vector<ColumnMatch>& matches,
+                      boost::uint64_t& count);
+
+private:
+    // one log's columns.  its lock is held while they're brought up to
+    // date and filtered, m_lock only while finding it, so other logs
+    // can be queried meanwhile.
+    struct Entry {
+        Entry() : loaded(false) {}
+        boost::mutex lock;
+        LogColumns columns;
+        // persisted columns have been looked for
+        bool loaded;
+    };
+
+    boost::filesystem::path persistPath(const boost::filesystem::path& path) const;
+
+    boost::mutex m_lock;
+    boost::filesystem::path m_dir;
+    std::map<boost::filesystem::path, boost::shared_ptr<Entry> > m_columns;
+};
+
+}
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_dir.h"
+#include "logaccess_stats.h"
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using logaccess::DirEntry;
+using logaccess::DirReader;
+using logaccess::FileInfo;
+
+#define COUNT_IO(what) logaccess::stats::count(logaccess::stats::what)
+
+#ifdef WINDOWS
+static std::time_t
+fileTimeToTime(const FILETIME& ft) {
+    // 100ns intervals since 1601 -> seconds since 1970
+    ULARGE_INTEGER t;
+    t.LowPart = ft.dwLowDateTime;
+    t.HighPart = ft.dwHighDateTime;
+    return (std::time_t)((t.QuadPart - 116444736000000000ULL) / 10000000ULL);
+}
+
+static void
+infoFromAttributes(DWORD attrs, DWORD sizeHigh, DWORD sizeLow,
+                   const FILETIME& writeTime, FileInfo& info) {
+    info.isDir = (attrs & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    info.isFile = !info.isDir && (attrs & FILE_ATTRIBUTE_DEVICE) == 0;
+    info.size = ((boost::uint64_t) sizeHigh << 32) | sizeLow;
+    info.mtime = fileTimeToTime(writeTime);
+}
+
+DirReader::DirReader(const boost::filesystem::path& dir)
+    : m_dir(dir), m_failed(false), m_havePending(false) {
+    std::wstring pattern = (dir / L"*").wstring();
+    COUNT_IO(kDirsOpened);
+    m_find = FindFirstFileW(pattern.c_str(), &m_data);
+    m_havePending = (m_find != INVALID_HANDLE_VALUE);
+}
+
+DirReader::~DirReader() {
+    if (m_find != INVALID_HANDLE_VALUE) {
+        FindClose(m_find);
+    }
+}
+
+bool
+DirReader::ok() const {
+    return m_find != INVALID_HANDLE_VALUE;
+}
+
+bool
+DirReader::next(DirEntry& entry) {
+    while (m_havePending) {
+        m_havePending = false;
+        std::wstring name(m_data.cFileName);
+        if (name != L"." && name != L"..") {
+            entry.name = name;
+            entry.haveInfo = true;
+            infoFromAttributes(m_data.dwFileAttributes, m_data.nFileSizeHigh,
+                               m_data.nFileSizeLow, m_data.ftLastWriteTime, entry.info);
+            entry.type = entry.info.isDir ? DirEntry::Dir
+                       : entry.info.isFile ? DirEntry::File : DirEntry::Other;
+        }
+        COUNT_IO(kEntriesScanned);
+        if (FindNextFileW(m_find, &m_data)) {
+            m_havePending = true;
+        } else if (GetLastError() != ERROR_NO_MORE_FILES) {
+            m_failed = true;
+        }
+        if (name != L"." && name != L"..") {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+DirReader::stat(const DirEntry& entry, FileInfo& info) {
+    if (entry.haveInfo) {
+        info = entry.info;
+        return true;
+    }
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    COUNT_IO(kStatCalls);
+    if (!GetFileAttributesExW((m_dir / entry.name).wstring().c_str(),
+                              GetFileExInfoStandard, &data)) {
+        return false;
+    }
+    infoFromAttributes(data.dwFileAttributes, data.nFileSizeHigh,
+                       data.nFileSizeLow, data.ftLastWriteTime, info);
+    return true;
+}
+
+#else
+
+DirReader::DirReader(const boost::filesystem::path& dir)
+    : m_dir(dir), m_failed(false), m_dirp(NULL) {
+    COUNT_IO(kDirsOpened);
+    m_dirp = opendir(dir.string().c_str());
+}
+
+DirReader::~DirReader() {
+    if (m_dirp) {
+        closedir(m_dirp);
+    }
+}
+
+bool
+DirReader::ok() const {
+    return m_dirp != NULL;
+}
+
+bool
+DirReader::next(DirEntry& entry) {
+    if (!m_dirp) {
+        return false;
+    }
+    for (;;) {
+        errno = 0;
+        COUNT_IO(kEntriesScanned);
+        struct dirent* d = readdir(m_dirp);
+        if (!d) {
+            m_failed = (errno != 0);
+            return false;
+        }
+        if (!strcmp(d->d_name, ".") || !strcmp(d->d_name, "..")) {
+            continue;
+        }
+        entry.name = d->d_name;
+        entry.haveInfo = false;
+        switch (d->d_type) {
+            case DT_REG: entry.type = DirEntry::File; break;
+            case DT_DIR: entry.type = DirEntry::Dir; break;
+            case DT_UNKNOWN: case DT_LNK: entry.type = DirEntry::Unknown; break;
+            default: entry.type = DirEntry::Other; break;
+        }
+        return true;
+    }
+}
+
+bool
+DirReader::stat(const DirEntry& entry, FileInfo& info) {
+    if (!m_dirp) {
+        return false;
+    }
+    struct stat sb;
+    COUNT_IO(kStatCalls);
+#ifdef AT_FDCWD
+    if (fstatat(dirfd(m_dirp), entry.name.string().c_str(), &sb, 0) != 0) {
+        return false;
+    }
+#else
+    if (::stat((m_dir / entry.name).string().c_str(), &sb) != 0) {
+        return false;
+    }
+#endif
+    info.isDir = S_ISDIR(sb.st_mode);
+    info.isFile = S_ISREG(sb.st_mode);
+    info.size = sb.st_size;
+    info.mtime = sb.st_mtime;
+    return true;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_DIR_H__
+#define __LOGACCESS_DIR_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <ctime>
+
+#ifdef WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace logaccess {
+
+struct FileInfo {
+    FileInfo() : isDir(false), isFile(false), size(0), mtime(0) {}
+    bool isDir;
+    bool isFile;
+    boost::uint64_t size;
+    std::time_t mtime;
+};
+
+struct DirEntry {
+    enum Type { Unknown, File, Dir, Other };
+    DirEntry() : type(Unknown), haveInfo(false) {}
+    boost::filesystem::path name;
+    // from the directory listing itself where the platform provides it,
+    // Unknown means a stat is needed to tell
+    Type type;
+    // true if info was filled in by the listing (windows)
+    bool haveInfo;
+    FileInfo info;
+};
+
+// Lists a single directory without stat'ing its entries.  Entries that
+// are of interest can be stat'ed relative to the open directory, which
+// avoids resolving the full path again for each one.  Directories
+// opened, entries read and stats are counted (see logaccess_stats.h).
+class DirReader : boost::noncopyable {
+public:
+    explicit DirReader(const boost::filesystem::path& dir);
+    ~DirReader();
+
+    // false if the directory couldn't be opened
+    bool ok() const;
+
+    const boost::filesystem::path& dir() const { return m_dir; }
+
+    // next entry, "." and ".." are skipped.  false at end of directory
+    // or on error (see failed())
+    bool next(DirEntry& entry);
+
+    // true if next() stopped because of an error
+    bool failed() const { return m_failed; }
+
+    // size, time and type of an entry returned by next()
+    bool stat(const DirEntry& entry, FileInfo& info);
+
+private:
+    boost::filesystem::path m_dir;
+    bool m_failed;
+#ifdef WINDOWS
+    HANDLE m_find;
+    WIN32_FIND_DATAW m_data;
+    bool m_havePending;
+#else
+    DIR* m_dirp;
+#endif
+};
+
+}
+
+#endif
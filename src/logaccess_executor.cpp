@@ -0,0 +1,99 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_executor.h"
+#include <boost/bind.hpp>
+
+using logaccess::Canceller;
+using logaccess::Executor;
+
+Executor::Executor(unsigned int threads) : m_stopping(false) {
+    for (unsigned int i = 0; i < threads; i++) {
+        m_threads.create_thread(boost::bind(&Executor::work, this));
+    }
+}
+
+Executor::~Executor() {
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+    m_cond.notify_all();
+    m_threads.join_all();
+}
+
+void
+Executor::post(const Job& job) {
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        if (m_stopping) {
+            return;
+        }
+        m_jobs.push_back(job);
+    }
+    m_cond.notify_one();
+}
+
+void
+Executor::work() {
+    for (;;) {
+        Job job;
+        {
+            boost::mutex::scoped_lock lock(m_lock);
+            while (!m_stopping && m_jobs.empty()) {
+                m_cond.wait(lock);
+            }
+            if (m_stopping) {
+                return;
+            }
+            job.swap(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+Canceller::Canceller() : m_cancelled(false) {
+}
+
+void
+Canceller::cancel() {
+    boost::mutex::scoped_lock lock(m_lock);
+    m_cancelled = true;
+}
+
+bool
+Canceller::cancelled() {
+    boost::mutex::scoped_lock lock(m_lock);
+    return m_cancelled;
+}
+
+bool
+Canceller::run(const boost::function<void ()>& fn) {
+    boost::mutex::scoped_lock lock(m_lock);
+    if (m_cancelled) {
+        return false;
+    }
+    fn();
+    return true;
+}
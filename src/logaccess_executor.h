@@ -0,0 +1,78 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_EXECUTOR_H__
+#define __LOGACCESS_EXECUTOR_H__
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include <deque>
+#include <vector>
+
+namespace logaccess {
+
+// A fixed set of worker threads running posted jobs in the order they
+// were posted.  Jobs still queued when the executor is destroyed are
+// dropped, ones running are waited for.
+class Executor : boost::noncopyable {
+public:
+    typedef boost::function<void ()> Job;
+
+    explicit Executor(unsigned int threads);
+    ~Executor();
+
+    void post(const Job& job);
+
+private:
+    void work();
+
+    boost::mutex m_lock;
+    boost::condition_variable m_cond;
+    std::deque<Job> m_jobs;
+    bool m_stopping;
+    boost::thread_group m_threads;
+};
+
+// Stands between work finishing on some worker and whoever asked for
+// it.  Once cancel() returns nothing more is run through it, so the
+// asker can go away.
+class Canceller : boost::noncopyable {
+public:
+    Canceller();
+
+    // waits for a run() in progress
+    void cancel();
+    bool cancelled();
+
+    // run fn unless cancelled, false if it wasn't run
+    bool run(const boost::function<void ()>& fn);
+
+private:
+    boost::mutex m_lock;
+    bool m_cancelled;
+};
+
+}
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_file.h"
+#include "logaccess_stats.h"
+#include <algorithm>
+
+#ifndef WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using logaccess::File;
+using logaccess::LineBlockReader;
+
+#ifdef WINDOWS
+
+File::File() : m_handle(INVALID_HANDLE_VALUE) {
+}
+
+bool
+File::open(const boost::filesystem::path& path) {
+    close();
+    m_handle = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+                           FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    return m_handle != INVALID_HANDLE_VALUE;
+}
+
+void
+File::close() {
+    if (m_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+    }
+}
+
+bool
+File::isOpen() const {
+    return m_handle != INVALID_HANDLE_VALUE;
+}
+
+bool
+File::size(boost::uint64_t& size) const {
+    LARGE_INTEGER li;
+    if (!GetFileSizeEx(m_handle, &li)) {
+        return false;
+    }
+    size = li.QuadPart;
+    return true;
+}
+
+bool
+File::id(logaccess::FileId& id) const {
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(m_handle, &info)) {
+        return false;
+    }
+    id.volume = info.dwVolumeSerialNumber;
+    id.index = ((boost::uint64_t) info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return true;
+}
+
+bool
+logaccess::fileId(const boost::filesystem::path& path, logaccess::FileId& id) {
+    File f;
+    return f.open(path) && f.id(id);
+}
+
+long long
+File::readAt(boost::uint64_t offset, char* buf, std::size_t len) const {
+    OVERLAPPED ov;
+    ZeroMemory(&ov, sizeof(ov));
+    ov.Offset = (DWORD) offset;
+    ov.OffsetHigh = (DWORD) (offset >> 32);
+    DWORD got = 0;
+    if (len > 0x40000000) {
+        len = 0x40000000;
+    }
+    if (!ReadFile(m_handle, buf, (DWORD) len, &got, &ov)) {
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+    logaccess::stats::count(logaccess::stats::kBytesRead, got);
+    return got;
+}
+
+void
+File::willNeed(boost::uint64_t /*offset*/, std::size_t /*len*/) const {
+    // windows has no hint for a range of a file, its read ahead picks
+    // up sequential reads on its own
+}
+
+#else
+
+File::File() : m_fd(-1) {
+}
+
+bool
+File::open(const boost::filesystem::path& path) {
+    close();
+    int flags = O_RDONLY;
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+    m_fd = ::open(path.string().c_str(), flags);
+    return m_fd >= 0;
+}
+
+void
+File::close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool
+File::isOpen() const {
+    return m_fd >= 0;
+}
+
+bool
+File::size(boost::uint64_t& size) const {
+    struct stat sb;
+    if (fstat(m_fd, &sb) != 0) {
+        return false;
+    }
+    size = sb.st_size;
+    return true;
+}
+
+bool
+File::id(logaccess::FileId& id) const {
+    struct stat sb;
+    if (fstat(m_fd, &sb) != 0) {
+        return false;
+    }
+    id.volume = sb.st_dev;
+    id.index = sb.st_ino;
+    return true;
+}
+
+bool
+logaccess::fileId(const boost::filesystem::path& path, logaccess::FileId& id) {
+    struct stat sb;
+    if (::stat(path.string().c_str(), &sb) != 0) {
+        return false;
+    }
+    id.volume = sb.st_dev;
+    id.index = sb.st_ino;
+    return true;
+}
+
+long long
+File::readAt(boost::uint64_t offset, char* buf, std::size_t len) const {
+    for (;;) {
+        ssize_t n = pread(m_fd, buf, len, (off_t) offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n > 0) {
+            logaccess::stats::count(logaccess::stats::kBytesRead, n);
+        }
+        return n;
+    }
+}
+
+void
+File::willNeed(boost::uint64_t offset, std::size_t len) const {
+#ifdef MACOSX
+    struct radvisory ra;
+    ra.ra_offset = (off_t) offset;
+    ra.ra_count = (int) std::min<std::size_t>(len, 0x7fffffff);
+    (void) fcntl(m_fd, F_RDADVISE, &ra);
+#elif defined(POSIX_FADV_WILLNEED)
+    (void) posix_fadvise(m_fd, (off_t) offset, (off_t) len, POSIX_FADV_WILLNEED);
+#endif
+}
+
+#endif
+
+File::~File() {
+    close();
+}
+
+bool
+File::read(boost::uint64_t offset, std::size_t len, std::string& out) const {
+    out.resize(len);
+    std::size_t got = 0;
+    while (got < len) {
+        long long n = readAt(offset + got, &out[got], len - got);
+        if (n < 0) {
+            out.clear();
+            return false;
+        } else if (n == 0) {
+            break;
+        }
+        got += (std::size_t) n;
+    }
+    out.resize(got);
+    return true;
+}
+
+LineBlockReader::LineBlockReader(const File& file, boost::uint64_t begin,
+                                 boost::uint64_t end, std::size_t blockSize)
+    : m_file(file), m_pos(begin), m_end(std::max(begin, end)),
+      m_blockSize(std::max<std::size_t>(1, blockSize)), m_failed(false), m_used(0) {
+}
+
+bool
+LineBlockReader::next(const char*& data, std::size_t& len, boost::uint64_t& offset) {
+    // what's left is a partial line, less than a block
+    m_buf.erase(0, m_used);
+    m_used = 0;
+    boost::uint64_t start = m_pos - m_buf.size();
+    if (m_pos < m_end && !m_failed) {
+        std::size_t have = m_buf.size();
+        std::size_t want = (std::size_t) std::min<boost::uint64_t>(m_blockSize, m_end - m_pos);
+        m_buf.resize(have + want);
+        std::size_t got = 0;
+        while (got < want) {
+            long long n = m_file.readAt(m_pos + got, &m_buf[have + got], want - got);
+            if (n < 0) {
+                m_failed = true;
+                return false;
+            }
+            if (n == 0) {
+                // truncated, this is the end now
+                m_end = m_pos + got;
+                break;
+            }
+            got += (std::size_t) n;
+        }
+        m_buf.resize(have + got);
+        m_pos += got;
+    }
+    if (m_buf.empty()) {
+        return false;
+    }
+    std::size_t n = m_buf.size();
+    if (m_pos < m_end) {
+        // keep a partial last line for the next block, unless there's
+        // nothing but
+        std::size_t nl = n;
+        while (nl > 0 && m_buf[nl - 1] != '\n') {
+            nl--;
+        }
+        if (nl > 0) {
+            n = nl;
+        }
+    }
+    m_used = n;
+    data = m_buf.data();
+    len = n;
+    offset = start;
+    return true;
+}
@@ -0,0 +1,121 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_FILE_H__
+#define __LOGACCESS_FILE_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <cstddef>
+#include <string>
+
+#ifdef WINDOWS
+#include <windows.h>
+#endif
+
+namespace logaccess {
+
+// Identifies a file independent of its name, so a log that has been
+// rotated (renamed away and replaced) can be told from the original.
+struct FileId {
+    FileId() : volume(0), index(0) {}
+    bool operator==(const FileId& o) const { return volume == o.volume && index == o.index; }
+    bool operator!=(const FileId& o) const { return !(*this == o); }
+    boost::uint64_t volume;
+    boost::uint64_t index;
+};
+
+// the id of the file currently at path
+bool fileId(const boost::filesystem::path& path, FileId& id);
+
+// A read only file handle that reads at explicit offsets, so it can
+// be shared between threads and never disturbs a writer.  Logs are
+// opened allowing the platform to keep writing, renaming and removing
+// them.
+class File : boost::noncopyable {
+public:
+    File();
+    ~File();
+
+    bool open(const boost::filesystem::path& path);
+    void close();
+    bool isOpen() const;
+
+    // current size of the file
+    bool size(boost::uint64_t& size) const;
+
+    // id of the open file, which may no longer be the one at its path
+    bool id(FileId& id) const;
+
+    // read up to len bytes at offset.  returns the number of bytes read,
+    // 0 at end of file, -1 on error.
+    long long readAt(boost::uint64_t offset, char* buf, std::size_t len) const;
+
+    // read [offset, offset + len) into out, stopping early at end of file
+    bool read(boost::uint64_t offset, std::size_t len, std::string& out) const;
+
+    // hint that [offset, offset + len) will be read soon, so the
+    // platform can start reading it ahead of us
+    void willNeed(boost::uint64_t offset, std::size_t len) const;
+
+private:
+#ifdef WINDOWS
+    HANDLE m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+// Reads [begin, end) of a file in blocks of whole lines, so a scan
+// never holds more than a block (and the line crossing its edge) in
+// memory.  A block ends just after a '\n', unless it's the last one or
+// holds a single line longer than the block size, which is then split.
+// A file that turns out shorter than end (truncated as we read) just
+// ends early.
+class LineBlockReader : boost::noncopyable {
+public:
+    LineBlockReader(const File& file, boost::uint64_t begin, boost::uint64_t end,
+                    std::size_t blockSize);
+
+    // the next block, [data, data + len) read from offset.  false at the
+    // end or on error (see failed())
+    bool next(const char*& data, std::size_t& len, boost::uint64_t& offset);
+
+    bool failed() const { return m_failed; }
+
+private:
+    const File& m_file;
+    // where the next read starts, and where to stop
+    boost::uint64_t m_pos;
+    boost::uint64_t m_end;
+    std::size_t m_blockSize;
+    bool m_failed;
+    std::string m_buf;
+    // bytes at the front of m_buf handed out by the last next(), the
+    // rest is a partial line carried over
+    std::size_t m_used;
+};
+
+}
+
+#endif
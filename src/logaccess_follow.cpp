@@ -0,0 +1,258 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_follow.h"
+#include "logaccess_watch.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
+
+using logaccess::Follower;
+using logaccess::FollowChunk;
+
+// longest we block without checking whether we've been stopped
+static const unsigned int kMaxWaitMs = 500;
+
+Follower::Follower(const std::vector<boost::filesystem::path>& files,
+                   const std::vector<boost::uint64_t>& offsets,
+                   unsigned int intervalMs, std::size_t maxBatch, const Sink& sink)
+    : m_files(files), m_intervalMs(intervalMs), m_maxBatch(maxBatch),
+      m_sink(sink), m_stop(false), m_done(false) {
+    for (std::size_t i = 0; i < files.size(); i++) {
+        State st;
+        st.path = files[i];
+        st.offset = i < offsets.size() ? offsets[i] : kFromEnd;
+        m_states.push_back(st);
+    }
+}
+
+Follower::~Follower() {
+}
+
+void
+Follower::stop() {
+    boost::mutex::scoped_lock lock(m_lock);
+    m_stop = true;
+    m_cond.notify_all();
+}
+
+bool
+Follower::done() {
+    boost::mutex::scoped_lock lock(m_lock);
+    return m_done;
+}
+
+std::vector<boost::uint64_t>
+Follower::offsets() {
+    boost::mutex::scoped_lock lock(m_lock);
+    std::vector<boost::uint64_t> rval;
+    for (std::vector<State>::const_iterator it = m_states.begin(); it != m_states.end(); ++it) {
+        rval.push_back(it->offset == kFromEnd ? 0 : it->offset);
+    }
+    return rval;
+}
+
+bool
+Follower::pause(unsigned int ms) {
+    boost::mutex::scoped_lock lock(m_lock);
+    if (!m_stop && ms > 0) {
+        m_cond.timed_wait(lock, boost::posix_time::milliseconds(ms));
+    }
+    return !m_stop;
+}
+
+bool
+Follower::reopen(State& st) {
+    boost::shared_ptr<File> f(new File);
+    FileId id;
+    if (!f->open(st.path) || !f->id(id)) {
+        return false;
+    }
+    st.file = f;
+    st.id = id;
+    return true;
+}
+
+bool
+Follower::poll(State& st, FollowChunk& chunk, bool& more, bool& replaced) {
+    more = false;
+    replaced = false;
+    if (!st.file) {
+        // not there when we started (or went away), it may be by now
+        if (!reopen(st)) {
+            return false;
+        }
+        boost::uint64_t size = 0;
+        if (st.offset == kFromEnd && st.file->size(size)) {
+            st.offset = size;
+        } else if (st.offset == kFromEnd) {
+            st.offset = 0;
+        }
+        replaced = true;
+    }
+    boost::uint64_t size = 0;
+    if (!st.file->size(size)) {
+        st.file.reset();
+        return false;
+    }
+    if (st.offset == kFromEnd) {
+        st.offset = size;
+    }
+    if (size < st.offset) {
+        // truncated in place, start over
+        st.offset = 0;
+        st.reset = true;
+    }
+    std::string data;
+    // whether the read got to the end of the file, before it was cut
+    // back to whole lines
+    bool atEnd = true;
+    if (size > st.offset) {
+        std::size_t len = (std::size_t) std::min<boost::uint64_t>(size - st.offset, m_maxBatch);
+        if (!st.file->read(st.offset, len, data)) {
+            return false;
+        }
+        atEnd = st.offset + data.size() >= size;
+        if (data.size() == m_maxBatch) {
+            more = true;
+        }
+        // only whole lines go out, unless a single line fills a batch
+        std::string::size_type nl = data.rfind('\n');
+        if (nl != std::string::npos) {
+            data.erase(nl + 1);
+        } else if (data.size() < m_maxBatch) {
+            data.clear();
+        }
+    }
+    FileId cur;
+    if (atEnd && logaccess::fileId(st.path, cur) && cur != st.id) {
+        // rotated away.  it may have been written to after its size was
+        // taken above and before the rename, so that's taken again.
+        // what's left of it, a last line without a newline too, goes out
+        // a batch at a time, then the replacement is picked up from its
+        // start.
+        boost::uint64_t from = st.offset + data.size();
+        boost::uint64_t end = size;
+        if (!st.file->size(end) || end < from) {
+            end = from;
+        }
+        if (end > from && data.size() < m_maxBatch) {
+            std::string rest;
+            std::size_t len = (std::size_t) std::min<boost::uint64_t>(end - from, m_maxBatch - data.size());
+            if (st.file->read(from, len, rest)) {
+                data += rest;
+            } else {
+                end = from;
+            }
+        }
+        if (st.offset + data.size() < end) {
+            // more left in the old file, a full batch of it goes out now
+            std::string::size_type nl = data.rfind('\n');
+            if (nl != std::string::npos) {
+                data.erase(nl + 1);
+            }
+            more = true;
+        } else {
+            if (!data.empty()) {
+                chunk.path = st.path;
+                chunk.offset = st.offset;
+                chunk.data = data;
+                chunk.reset = st.reset;
+            }
+            if (!reopen(st)) {
+                st.file.reset();
+            }
+            st.offset = 0;
+            st.reset = true;
+            more = true;
+            replaced = true;
+            return !data.empty();
+        }
+    }
+    if (data.empty()) {
+        return false;
+    }
+    chunk.path = st.path;
+    chunk.offset = st.offset;
+    chunk.data = data;
+    chunk.reset = st.reset;
+    st.offset += data.size();
+    st.reset = false;
+    return true;
+}
+
+void
+Follower::run(unsigned int durationMs) {
+    boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time()
+        + boost::posix_time::milliseconds(durationMs);
+    for (std::vector<State>::iterator it = m_states.begin(); it != m_states.end(); ++it) {
+        if (reopen(*it) && it->offset == kFromEnd) {
+            it->file->size(it->offset);
+        }
+    }
+    FileNotifier notifier;
+    notifier.watch(m_files);
+    // anything between the given offsets and the end goes out first
+    bool pending = true;
+    for (;;) {
+        boost::posix_time::time_duration left =
+            deadline - boost::posix_time::microsec_clock::universal_time();
+        if (left.is_negative()) {
+            break;
+        }
+        if (!pending) {
+            unsigned int wait = (unsigned int) std::min<long long>(kMaxWaitMs, left.total_milliseconds());
+            bool woke = notifier.wait(wait);
+            if (!pause(0)) {
+                break;
+            }
+            if (!woke) {
+                continue;
+            }
+            // let the rest of a burst of writes land before reading
+            if (!pause(m_intervalMs)) {
+                break;
+            }
+        } else if (!pause(0)) {
+            break;
+        }
+        pending = false;
+        bool rewatch = false;
+        std::vector<FollowChunk> chunks;
+        for (std::vector<State>::iterator it = m_states.begin(); it != m_states.end(); ++it) {
+            FollowChunk chunk;
+            bool more = false, replaced = false;
+            if (poll(*it, chunk, more, replaced)) {
+                chunks.push_back(chunk);
+            }
+            pending = pending || more;
+            rewatch = rewatch || replaced;
+        }
+        if (rewatch) {
+            notifier.watch(m_files);
+        }
+        if (!chunks.empty()) {
+            m_sink(chunks);
+        }
+    }
+    boost::mutex::scoped_lock lock(m_lock);
+    m_done = true;
+}
@@ -0,0 +1,114 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_FOLLOW_H__
+#define __LOGACCESS_FOLLOW_H__
+
+#include "logaccess_file.h"
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct FollowChunk {
+    FollowChunk() : offset(0), reset(false) {}
+    boost::filesystem::path path;
+    // where data starts in the file
+    boost::uint64_t offset;
+    std::string data;
+    // the file was replaced or truncated, data (and offset) are for the
+    // file now at path
+    bool reset;
+};
+
+// Pushes data appended to a set of logfiles to a sink as it is written.
+// A read happens only when the files are reported changed, and is held
+// back for a short interval so that bursts of writes go out as a single
+// batch.  Each wakeup reads each changed file once, at most maxBatch
+// bytes, ending on a line boundary.  Logs that are rotated are read to
+// their end before the replacement is picked up from its start.
+class Follower : boost::noncopyable {
+public:
+    typedef boost::function<void (const std::vector<FollowChunk>&)> Sink;
+
+    // start from the current end of a file
+    static const boost::uint64_t kFromEnd = (boost::uint64_t) -1;
+
+    // offsets[i] is where to start in files[i]
+    Follower(const std::vector<boost::filesystem::path>& files,
+             const std::vector<boost::uint64_t>& offsets,
+             unsigned int intervalMs, std::size_t maxBatch, const Sink& sink);
+    ~Follower();
+
+    // push data to the sink until stop() is called or durationMs passes.
+    // runs on the calling thread.
+    void run(unsigned int durationMs);
+
+    // make run() return soon, from any thread
+    void stop();
+
+    // true once run() has returned
+    bool done();
+
+    const std::vector<boost::filesystem::path>& files() const { return m_files; }
+
+    // how far into each file data has been pushed, valid once done()
+    std::vector<boost::uint64_t> offsets();
+
+private:
+    struct State {
+        State() : offset(0), reset(false) {}
+        boost::filesystem::path path;
+        boost::shared_ptr<File> file;
+        FileId id;
+        boost::uint64_t offset;
+        bool reset;
+    };
+
+    // read what's new in st into chunk.  more is set if there's more to
+    // read right away, replaced if st now refers to a new file.
+    bool poll(State& st, FollowChunk& chunk, bool& more, bool& replaced);
+    bool reopen(State& st);
+    // sleep up to ms, returns false if stopped
+    bool pause(unsigned int ms);
+
+    std::vector<boost::filesystem::path> m_files;
+    std::vector<State> m_states;
+    unsigned int m_intervalMs;
+    std::size_t m_maxBatch;
+    Sink m_sink;
+    boost::mutex m_lock;
+    boost::condition_variable m_cond;
+    bool m_stop;
+    bool m_done;
+};
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_index.h"
+#include "logaccess_line.h"
+#include "logaccess_stats.h"
+#include <algorithm>
+#include <cstring>
+
+using logaccess::RangeResult;
+using logaccess::TimeIndex;
+using logaccess::TimeIndexCache;
+
+const boost::uint64_t TimeIndex::kIndexStride;
+
+// how far past a stride boundary we look for a timestamped line
+static const std::size_t kProbeSize = 4096;
+
+// how much is read at a time while gathering a range
+static const std::size_t kRangeChunk = 64 * 1024;
+
+// enough of the start of a line to hold its timestamp
+static const std::size_t kLineHead = 64;
+
+TimeIndex::TimeIndex() : m_next(0), m_size(0) {
+}
+
+bool
+TimeIndex::update(const File& file, const FileId& id, boost::uint64_t size) {
+    if (id != m_id || size < m_size) {
+        // rotated or truncated, what we knew is worthless
+        m_id = id;
+        m_next = 0;
+        m_marks.clear();
+    }
+    m_size = size;
+    std::string probe;
+    while (m_next + kProbeSize <= size) {
+        if (!file.read(m_next, kProbeSize, probe)) {
+            return false;
+        }
+        // the first line that starts in the probe (the one at the boundary
+        // itself only if it's the start of the file) with a timestamp
+        const char* p = probe.data();
+        const char* end = p + probe.size();
+        if (m_next > 0) {
+            p = (const char*) memchr(p, '\n', end - p);
+            p = p ? p + 1 : end;
+        }
+        while (p < end) {
+            boost::int64_t t;
+            if (parseTimestamp(p, end, t)) {
+                Mark m;
+                // keep marks ordered even if lines are logged out of order
+                m.time = m_marks.empty() ? t : std::max(t, m_marks.back().time);
+                m.offset = m_next + (p - probe.data());
+                m_marks.push_back(m);
+                break;
+            }
+            p = (const char*) memchr(p, '\n', end - p);
+            p = p ? p + 1 : end;
+        }
+        m_next += kIndexStride;
+    }
+    return true;
+}
+
+namespace {
+    struct MarkTimeLess {
+        template <class M> bool operator()(const M& m, boost::int64_t t) const { return m.time < t; }
+    };
+}
+
+boost::uint64_t
+TimeIndex::seek(boost::int64_t time) const {
+    // the last mark strictly before time, every line logged at or after
+    // time is after it
+    std::vector<Mark>::const_iterator it =
+        std::lower_bound(m_marks.begin(), m_marks.end(), time, MarkTimeLess());
+    if (it == m_marks.begin()) {
+        return 0;
+    }
+    return (it - 1)->offset;
+}
+
+std::string
+TimeIndexCache::seek(const boost::filesystem::path& path, const File& file,
+                     boost::int64_t from, boost::uint64_t& offset) {
+    FileId id;
+    boost::uint64_t size = 0;
+    if (!file.id(id) || !file.size(size)) {
+        return std::string("unable to open ") + path.string();
+    }
+    boost::mutex::scoped_lock lock(m_lock);
+    logaccess::stats::count(m_indexes.count(path) ? logaccess::stats::kCacheHits
+                                                  : logaccess::stats::kCacheMisses);
+    TimeIndex& index = m_indexes[path];
+    if (!index.update(file, id, size)) {
+        m_indexes.erase(path);
+        return std::string("unable to read ") + path.string();
+    }
+    offset = index.seek(from);
+    return std::string();
+}
+
+// take the line [p, p + len) starting at offset into result if it's in
+// range, false once the range is over or result is full.  inRange
+// carries the time of the last timestamped line to lines without one.
+static bool
+takeLine(const char* p, std::size_t len, boost::uint64_t offset, boost::int64_t from,
+         boost::int64_t to, std::size_t maxBytes, bool& inRange, RangeResult& result) {
+    boost::int64_t t;
+    if (logaccess::parseTimestamp(p, p + len, t)) {
+        if (t > to) {
+            return false;
+        }
+        inRange = (t >= from);
+    }
+    if (!inRange) {
+        return true;
+    }
+    if (result.data.size() + len > maxBytes) {
+        result.truncated = true;
+        return false;
+    }
+    if (result.data.empty()) {
+        result.offset = offset;
+    }
+    result.data.append(p, len);
+    return true;
+}
+
+std::string
+TimeIndexCache::range(const boost::filesystem::path& path, boost::int64_t from,
+                      boost::int64_t to, std::size_t maxBytes, RangeResult& result) {
+    File file;
+    boost::uint64_t size = 0;
+    if (!file.open(path) || !file.size(size)) {
+        return std::string("unable to open ") + path.string();
+    }
+    boost::uint64_t pos;
+    std::string error = seek(path, file, from, pos);
+    if (!error.empty()) {
+        return error;
+    }
+    // walk lines forward from pos.  a line cut by the end of a read is
+    // finished in carry, which keeps no more of it than could be
+    // returned: past that only its timestamp matters, and it can't fit.
+    const std::size_t cap = std::max(maxBytes, kLineHead) + 1;
+    bool inRange = false;
+    std::string buf;
+    std::string carry;
+    boost::uint64_t carryStart = 0;
+    while (pos < size) {
+        if (!file.read(pos, kRangeChunk, buf)) {
+            return std::string("unable to read ") + path.string();
+        }
+        if (buf.empty()) {
+            break;
+        }
+        const boost::uint64_t bufStart = pos;
+        pos += buf.size();
+        const char* p = buf.data();
+        const char* end = p + buf.size();
+        if (!carry.empty()) {
+            const char* nl = (const char*) memchr(p, '\n', end - p);
+            const char* eol = nl ? nl + 1 : end;
+            carry.append(p, std::min((std::size_t) (eol - p), cap - std::min(cap, carry.size())));
+            p = eol;
+            if (!nl && pos < size) {
+                continue;
+            }
+            if (!takeLine(carry.data(), carry.size(), carryStart, from, to, maxBytes,
+                          inRange, result)) {
+                return std::string();
+            }
+            carry.clear();
+        }
+        for (;;) {
+            const char* nl = (const char*) memchr(p, '\n', end - p);
+            if (!nl && pos < size) {
+                // partial line, finish it with the next read
+                if (p < end) {
+                    carry.assign(p, std::min((std::size_t) (end - p), cap));
+                    carryStart = bufStart + (p - buf.data());
+                }
+                break;
+            }
+            const char* eol = nl ? nl + 1 : end;
+            if (p == eol) {
+                break;
+            }
+            if (!takeLine(p, eol - p, bufStart + (p - buf.data()), from, to, maxBytes,
+                          inRange, result)) {
+                return std::string();
+            }
+            p = eol;
+            if (!nl) {
+                break;
+            }
+        }
+    }
+    return std::string();
+}
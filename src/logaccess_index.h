@@ -0,0 +1,99 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_INDEX_H__
+#define __LOGACCESS_INDEX_H__
+
+#include "logaccess_file.h"
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+// A sparse map from time to byte offset for one logfile, with a mark
+// for the first timestamped line after every kIndexStride bytes.
+// Building it reads a few hundred bytes per stride rather than the
+// whole file.
+class TimeIndex {
+public:
+    // spacing of marks
+    static const boost::uint64_t kIndexStride = 64 * 1024;
+
+    TimeIndex();
+
+    // bring the index up to date with file (whose id and size are
+    // given).  a file that has grown is indexed from where we left off,
+    // one that's been replaced or truncated from scratch.
+    bool update(const File& file, const FileId& id, boost::uint64_t size);
+
+    // an offset of a line start at or before the first line logged at
+    // or after time
+    boost::uint64_t seek(boost::int64_t time) const;
+
+private:
+    struct Mark {
+        boost::int64_t time;
+        boost::uint64_t offset;
+    };
+    FileId m_id;
+    // the next stride boundary to examine
+    boost::uint64_t m_next;
+    boost::uint64_t m_size;
+    std::vector<Mark> m_marks;
+};
+
+struct RangeResult {
+    RangeResult() : offset(0), truncated(false) {}
+    // where data starts in the file
+    boost::uint64_t offset;
+    std::string data;
+    // true if maxBytes was reached before the end of the range
+    bool truncated;
+};
+
+// TimeIndexes of the logfiles that have been queried, built on first
+// use and kept for the life of the service instance.
+class TimeIndexCache : boost::noncopyable {
+public:
+    // the lines of path logged in [from, to], at most maxBytes of them.
+    // lines without a timestamp belong with the line before them.
+    std::string range(const boost::filesystem::path& path, boost::int64_t from,
+                      boost::int64_t to, std::size_t maxBytes, RangeResult& result);
+
+    // where to start reading path (open as file) so as not to miss any
+    // line logged at or after from
+    std::string seek(const boost::filesystem::path& path, const File& file,
+                     boost::int64_t from, boost::uint64_t& offset);
+
+private:
+    boost::mutex m_lock;
+    std::map<boost::filesystem::path, TimeIndex> m_indexes;
+};
+
+}
+
+#endif
@@ -0,0 +1,221 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_line.h"
+
+// parse exactly n digits
+static bool
+digits(const char*& p, const char* end, int n, int& value) {
+    if (end - p < n) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < n; i++, p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+static bool
+expect(const char*& p, const char* end, char c) {
+    if (p >= end || *p != c) {
+        return false;
+    }
+    p++;
+    return true;
+}
+
+// days since 1970-01-01 of a proleptic gregorian date
+static boost::int64_t
+daysFromCivil(int y, int m, int d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (boost::int64_t) era * 146097 + doe - 719468;
+}
+
+bool
+logaccess::parseTimestamp(const char* p, const char* end, boost::int64_t& ms,
+                          const char** after) {
+    if (p < end && *p == '[') {
+        p++;
+    }
+    int year, month, day, hour, minute, second;
+    if (!digits(p, end, 4, year) || !expect(p, end, '-')
+        || !digits(p, end, 2, month) || !expect(p, end, '-')
+        || !digits(p, end, 2, day)) {
+        return false;
+    }
+    if (p >= end || (*p != ' ' && *p != 'T')) {
+        return false;
+    }
+    p++;
+    if (!digits(p, end, 2, hour) || !expect(p, end, ':')
+        || !digits(p, end, 2, minute) || !expect(p, end, ':')
+        || !digits(p, end, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31
+        || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+    int millis = 0;
+    if (p < end && (*p == '.' || *p == ',')) {
+        p++;
+        // take up to 3 digits, skip any finer ones
+        int n = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++, n++) {
+            if (n < 3) {
+                millis = millis * 10 + (*p - '0');
+            }
+        }
+        for (; n < 3; n++) {
+            millis *= 10;
+        }
+    }
+    if (p < end && *p == ']') {
+        p++;
+    }
+    ms = ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60 + second;
+    ms = ms * 1000 + millis;
+    if (after) {
+        *after = p;
+    }
+    return true;
+}
+
+bool
+logaccess::parseTimestamp(const std::string& s, boost::int64_t& ms) {
+    const char* p = s.data();
+    const char* end = p + s.size();
+    if (!parseTimestamp(p, end, ms, &p)) {
+        return false;
+    }
+    // "YYYY-MM-DD" alone would have failed above, trailing junk is an error
+    return p == end;
+}
+
+static const char* s_levelNames[] = {
+    "UNKNOWN", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
+};
+
+const char*
+logaccess::levelName(LogLevel level) {
+    return (level >= 0 && level < kNumLevels) ? s_levelNames[level] : s_levelNames[0];
+}
+
+logaccess::LogLevel
+logaccess::parseLevel(const char* s, std::size_t len) {
+    char buf[8];
+    if (len == 0 || len >= sizeof(buf)) {
+        return kLevelUnknown;
+    }
+    for (std::size_t i = 0; i < len; i++) {
+        buf[i] = (s[i] >= 'a' && s[i] <= 'z') ? (char) (s[i] - 'a' + 'A') : s[i];
+    }
+    buf[len] = 0;
+    std::string l(buf);
+    if (l == "DEBUG" || l == "TRACE") {
+        return kLevelDebug;
+    } else if (l == "INFO") {
+        return kLevelInfo;
+    } else if (l == "WARN" || l == "WARNING") {
+        return kLevelWarn;
+    } else if (l == "ERROR" || l == "ERR") {
+        return kLevelError;
+    } else if (l == "FATAL" || l == "CRIT") {
+        return kLevelFatal;
+    }
+    return kLevelUnknown;
+}
+
+static inline bool
+isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == '|' || c == '[' || c == ']';
+}
+
+static inline bool
+isLineEnd(char c) {
+    return c == '\n' || c == '\r';
+}
+
+// the next field of [p, end), skipping separators
+static bool
+token(const char*& p, const char* end, const char*& tok, std::size_t& len) {
+    while (p < end && isSeparator(*p)) {
+        p++;
+    }
+    tok = p;
+    while (p < end && !isSeparator(*p) && !isLineEnd(*p)) {
+        p++;
+    }
+    len = p - tok;
+    return len > 0;
+}
+
+bool
+logaccess::parseLine(const char* p, const char* end, LineFields& fields) {
+    if (!parseTimestamp(p, end, fields.time, &p)) {
+        return false;
+    }
+    const char* rest = p;
+    const char* tok;
+    std::size_t len;
+    if (token(p, end, tok, len)) {
+        fields.level = parseLevel(tok, len);
+    }
+    if (fields.level == kLevelUnknown) {
+        // not the layout we know, the rest is all message
+        p = rest;
+    } else {
+        rest = p;
+        if (token(p, end, tok, len) && *tok != '-') {
+            fields.thread = tok;
+            fields.threadLen = len;
+            rest = p;
+            if (token(p, end, tok, len) && *tok != '-') {
+                // source file (or category), minus extension and line
+                std::size_t stem = 0;
+                while (stem < len && tok[stem] != '.' && tok[stem] != ':') {
+                    stem++;
+                }
+                fields.category = tok;
+                fields.categoryLen = stem;
+                rest = p;
+            }
+        }
+        p = rest;
+    }
+    while (p < end && isSeparator(*p)) {
+        p++;
+    }
+    if (p + 1 < end && (*p == '-' || *p == ':') && p[1] == ' ') {
+        p += 2;
+    }
+    fields.message = p;
+    return true;
+}
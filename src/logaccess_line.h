@@ -0,0 +1,81 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_LINE_H__
+#define __LOGACCESS_LINE_H__
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+#include <string>
+
+namespace logaccess {
+
+// parse a "YYYY-MM-DD HH:MM:SS" timestamp, optionally followed by
+// fractional seconds (".mmm" or ",mmm") and optionally wrapped in '[',
+// from the start of [p, end).  the time is taken as written, with no
+// timezone applied, and returned as milliseconds since 1970-01-01.
+// if after is non-NULL it's pointed just past the timestamp.
+bool parseTimestamp(const char* p, const char* end, boost::int64_t& ms,
+                    const char** after = NULL);
+
+// same, for a timestamp given as an argument
+bool parseTimestamp(const std::string& s, boost::int64_t& ms);
+
+// log levels, ordered by severity
+enum LogLevel {
+    kLevelUnknown = 0,
+    kLevelDebug,
+    kLevelInfo,
+    kLevelWarn,
+    kLevelError,
+    kLevelFatal,
+    kNumLevels
+};
+
+// the level named by s ("warn", "WARNING", ...), kLevelUnknown if none
+LogLevel parseLevel(const char* s, std::size_t len);
+const char* levelName(LogLevel level);
+
+// The parts of a log line.  A line is a timestamp followed by a level,
+// a thread id and a category (the source file, with any extension and
+// line number dropped), separated by spaces, '|' or brackets, and then
+// the message after an optional "-" or ":".  Fields that are missing
+// are left empty.
+struct LineFields {
+    LineFields() : time(0), level(kLevelUnknown), thread(NULL), threadLen(0),
+                   category(NULL), categoryLen(0), message(NULL) {}
+    boost::int64_t time;
+    LogLevel level;
+    const char* thread;
+    std::size_t threadLen;
+    const char* category;
+    std::size_t categoryLen;
+    const char* message;
+};
+
+// split the line [p, end) into its fields.  false if it doesn't start
+// with a timestamp (a continuation of the line before it).
+bool parseLine(const char* p, const char* end, LineFields& fields);
+
+}
+
+#endif
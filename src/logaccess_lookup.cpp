@@ -0,0 +1,162 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_lookup.h"
+#include "logaccess_pool.h"
+#include <boost/bind.hpp>
+#include <boost/weak_ptr.hpp>
+#include <algorithm>
+
+using logaccess::LogLookups;
+
+// lookups spend most of their time waiting on the disk, a couple of
+// them can overlap even on a single core
+static unsigned int
+lookupThreads() {
+    return std::max(2u, logaccess::pool::concurrency());
+}
+
+// services whose logs were asked for most recently, newest first.
+// they outlive any one LogLookups, the next one warms them up.
+static const unsigned int kRecentServices = 16;
+static boost::mutex s_recentLock;
+static std::vector<std::string> s_recent;
+
+static void
+noteRecent(const std::string& service) {
+    boost::mutex::scoped_lock lock(s_recentLock);
+    std::vector<std::string>::iterator it = std::find(s_recent.begin(), s_recent.end(), service);
+    if (it != s_recent.end()) {
+        s_recent.erase(it);
+    }
+    s_recent.insert(s_recent.begin(), service);
+    if (s_recent.size() > kRecentServices) {
+        s_recent.pop_back();
+    }
+}
+
+static void
+ignoreListing(const logaccess::Listing& /*listing*/) {
+}
+
+LogLookups::LogLookups()
+    : m_warming(new Canceller), m_executor(lookupThreads()) {
+}
+
+LogLookups::~LogLookups() {
+}
+
+static boost::mutex s_sharedLock;
+static boost::weak_ptr<LogLookups> s_shared;
+
+boost::shared_ptr<LogLookups>
+LogLookups::shared() {
+    boost::mutex::scoped_lock lock(s_sharedLock);
+    boost::shared_ptr<LogLookups> lookups = s_shared.lock();
+    if (!lookups) {
+        lookups.reset(new LogLookups);
+        s_shared = lookups;
+        lookups->warm();
+    }
+    return lookups;
+}
+
+void
+LogLookups::lookup(const std::string& service, bool details, stats::Method method,
+                   const boost::shared_ptr<Canceller>& canceller, const Handler& done) {
+    if (!service.empty() && method != stats::kWarmUp) {
+        noteRecent(service);
+    }
+    Waiter w;
+    w.canceller = canceller;
+    w.done = done;
+    Key key(service, details);
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        std::map<Key, Flight>::iterator it = m_flights.find(key);
+        if (it != m_flights.end()) {
+            // someone's waiting on a warm-up now, if it hasn't started
+            // its walk is theirs.  once started it stays warm-up's.
+            if (it->second.method == stats::kWarmUp) {
+                it->second.method = method;
+            }
+            it->second.waiters.push_back(w);
+            return;
+        }
+        Flight& f = m_flights[key];
+        f.method = method;
+        f.waiters.push_back(w);
+    }
+    m_executor.post(boost::bind(&LogLookups::run, this, key));
+}
+
+void
+LogLookups::run(const Key& key) {
+    stats::Method method;
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        Flight& f = m_flights[key];
+        bool wanted = false;
+        for (std::vector<Waiter>::const_iterator it = f.waiters.begin(); it != f.waiters.end(); ++it) {
+            if (!it->canceller->cancelled()) {
+                wanted = true;
+                break;
+            }
+        }
+        if (!wanted) {
+            m_flights.erase(key);
+            return;
+        }
+        method = f.method;
+    }
+    Listing listing;
+    {
+        stats::Attach attach(method);
+        listing.error = key.second ? m_cache.getLogfileDetails(key.first, listing.paths)
+                                   : m_cache.getServiceLogfilePaths(key.first, listing.paths);
+    }
+    // askers that came along while we walked get this answer too, any
+    // after this start a walk of their own
+    std::vector<Waiter> waiters;
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        waiters.swap(m_flights[key].waiters);
+        m_flights.erase(key);
+    }
+    for (std::vector<Waiter>::const_iterator it = waiters.begin(); it != waiters.end(); ++it) {
+        it->canceller->run(boost::bind(it->done, boost::cref(listing)));
+    }
+}
+
+void
+LogLookups::warm() {
+    std::vector<std::string> services;
+    {
+        boost::mutex::scoped_lock lock(s_recentLock);
+        services = s_recent;
+    }
+    // the platform first, it's what a page is most likely to ask for
+    lookup(std::string(), false, stats::kWarmUp, m_warming, ignoreListing);
+    for (std::vector<std::string>::const_iterator it = services.begin(); it != services.end(); ++it) {
+        lookup(*it, false, stats::kWarmUp, m_warming, ignoreListing);
+    }
+}
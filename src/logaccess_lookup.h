@@ -0,0 +1,108 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_LOOKUP_H__
+#define __LOGACCESS_LOOKUP_H__
+
+#include "bputil/bptypeutil.h"
+#include "logaccess_cache.h"
+#include "logaccess_executor.h"
+#include "logaccess_stats.h"
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace logaccess {
+
+// what a lookup of logfiles found
+struct Listing {
+    std::string error;
+    // paths, or maps of details if they were asked for
+    bplus::List paths;
+};
+
+// Finds logfiles on worker threads rather than the caller's.  Lookups
+// of the same logs that overlap are merged, later askers wait for the
+// walk already in flight rather than repeat it.  One LogLookups is
+// shared by all service instances alive at the same time.
+class LogLookups : boost::noncopyable {
+public:
+    typedef boost::function<void (const Listing&)> Handler;
+
+    LogLookups();
+    ~LogLookups();
+
+    // the instance shared by everyone holding it, created on demand.
+    // creating it starts finding the platform logs, and those of the
+    // services most recently looked up in this process, in the
+    // background.  whoever asks first joins that walk or finds its
+    // result cached.
+    static boost::shared_ptr<LogLookups> shared();
+
+    // find the logfiles of service (the platform's if empty), with
+    // their details if asked (see LogDirCache::getLogfileDetails()),
+    // then run done on a worker thread through canceller.  the walk is
+    // counted against the method of whoever started it, or of the first
+    // to join a warm-up before its walk starts.  one joining a walk
+    // under way, or finding its result cached, is counted no I/O.  a
+    // lookup all of whose askers have cancelled by the time a worker
+    // gets to it is skipped.
+    void lookup(const std::string& service, bool details, stats::Method method,
+                const boost::shared_ptr<Canceller>& canceller, const Handler& done);
+
+    // the cache lookups go through, for use on the caller's thread
+    LogDirCache& cache() { return m_cache; }
+
+private:
+    struct Waiter {
+        boost::shared_ptr<Canceller> canceller;
+        Handler done;
+    };
+    struct Flight {
+        stats::Method method;
+        std::vector<Waiter> waiters;
+    };
+
+    // a service and whether details are wanted
+    typedef std::pair<std::string, bool> Key;
+
+    void run(const Key& key);
+    void warm();
+
+    LogDirCache m_cache;
+    boost::mutex m_lock;
+    // the platform is service ""
+    std::map<Key, Flight> m_flights;
+    // warm-up lookups answer through this, nobody is waiting on them
+    boost::shared_ptr<Canceller> m_warming;
+    // last, so its workers stop before what they use goes away
+    Executor m_executor;
+};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_pool.h"
+#include "logaccess_stats.h"
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+
+namespace {
+    // hands out indices to whichever thread asks next
+    class Work {
+    public:
+        Work(unsigned int count, const boost::function<void (unsigned int)>& fn)
+            : m_count(count), m_next(0), m_fn(fn), m_method(logaccess::stats::current()) {}
+
+        void run() {
+            // workers count for the method that handed them the work
+            logaccess::stats::Attach attach(m_method);
+            for (;;) {
+                unsigned int i;
+                {
+                    boost::mutex::scoped_lock lock(m_lock);
+                    if (m_next >= m_count) {
+                        return;
+                    }
+                    i = m_next++;
+                }
+                m_fn(i);
+            }
+        }
+
+    private:
+        unsigned int m_count;
+        unsigned int m_next;
+        boost::mutex m_lock;
+        const boost::function<void (unsigned int)>& m_fn;
+        logaccess::stats::Method m_method;
+    };
+}
+
+unsigned int
+logaccess::pool::concurrency() {
+    unsigned int n = boost::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void
+logaccess::pool::parallelFor(unsigned int count,
+                             const boost::function<void (unsigned int)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    unsigned int workers = std::min(count, concurrency());
+    Work work(count, fn);
+    boost::thread_group threads;
+    for (unsigned int i = 1; i < workers; i++) {
+        threads.create_thread(boost::bind(&Work::run, &work));
+    }
+    work.run();
+    threads.join_all();
+}
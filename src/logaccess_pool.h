@@ -0,0 +1,43 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_POOL_H__
+#define __LOGACCESS_POOL_H__
+
+#include <boost/function.hpp>
+
+namespace logaccess {
+namespace pool {
+
+// how many threads are worth running at once on this machine
+unsigned int concurrency();
+
+// call fn(i) for every i in [0, count), spread over at most
+// min(count, concurrency()) threads.  the calling thread does its share
+// of the work, so nothing is started when there's only one item.
+// returns once every call has returned.  fn must not throw.
+void parallelFor(unsigned int count, const boost::function<void (unsigned int)>& fn);
+
+}
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_reader.h"
+#include "logaccess_file.h"
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <algorithm>
+
+using logaccess::ChunkReader;
+using logaccess::ReadChunk;
+
+namespace {
+    // a read of a ChunkReader, counted until we go out of scope
+    class Running : boost::noncopyable {
+    public:
+        explicit Running(boost::function<void ()> end) : m_end(end) {}
+        ~Running() { m_end(); }
+    private:
+        boost::function<void ()> m_end;
+    };
+}
+
+ChunkReader::ChunkReader(std::size_t maxChunk, unsigned int maxReads)
+    : m_maxChunk(std::max<std::size_t>(1, maxChunk)),
+      m_maxReads(std::max(1u, maxReads)), m_reads(0) {
+}
+
+ChunkReader::~ChunkReader() {
+}
+
+bool
+ChunkReader::begin() {
+    boost::mutex::scoped_lock lock(m_lock);
+    if (m_reads >= m_maxReads) {
+        return false;
+    }
+    m_reads++;
+    return true;
+}
+
+void
+ChunkReader::end() {
+    boost::mutex::scoped_lock lock(m_lock);
+    m_reads--;
+}
+
+std::string
+ChunkReader::read(const boost::filesystem::path& path, boost::uint64_t offset,
+                  std::size_t maxBytes, ReadChunk& chunk, bool& busy) {
+    chunk = ReadChunk();
+    chunk.offset = chunk.next = offset;
+    busy = false;
+    File file;
+    boost::uint64_t size = 0;
+    if (!file.open(path) || !file.size(size)) {
+        return std::string("unable to open ") + path.string();
+    }
+    if (offset > size) {
+        return path.string() + " is shorter than offset, it may have been rotated";
+    }
+    std::size_t want = (std::size_t) std::min<boost::uint64_t>(
+        std::min(std::max<std::size_t>(1, maxBytes), m_maxChunk), size - offset);
+    if (want == 0) {
+        chunk.eof = true;
+        return std::string();
+    }
+    if (!begin()) {
+        busy = true;
+        return std::string("too many reads in progress, try again later");
+    }
+    Running running(boost::bind(&ChunkReader::end, this));
+    chunk.data.resize(want);
+    std::size_t got = 0;
+    while (got < want) {
+        long long n = file.readAt(offset + got, &chunk.data[got], want - got);
+        if (n < 0) {
+            chunk.data.clear();
+            return std::string("unable to read ") + path.string();
+        }
+        if (n == 0) {
+            // truncated while we read
+            break;
+        }
+        got += (std::size_t) n;
+    }
+    std::size_t len = got;
+    bool eof = (offset + got >= size);
+    if (!eof) {
+        // end on a line boundary if there is one
+        std::size_t nl = got;
+        while (nl > 0 && chunk.data[nl - 1] != '\n') {
+            nl--;
+        }
+        if (nl > 0) {
+            len = nl;
+        }
+        file.willNeed(offset + len, want);
+    }
+    chunk.data.resize(len);
+    chunk.next = offset + len;
+    chunk.eof = eof;
+    return std::string();
+}
@@ -0,0 +1,80 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_READER_H__
+#define __LOGACCESS_READER_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+#include <cstddef>
+#include <string>
+
+namespace logaccess {
+
+struct ReadChunk {
+    ReadChunk() : offset(0), next(0), eof(false) {}
+    // where data starts in the file
+    boost::uint64_t offset;
+    // where to read from next
+    boost::uint64_t next;
+    // true if data reaches the end of the file
+    bool eof;
+    std::string data;
+};
+
+// Reads logfiles a chunk at a time, the caller asking for each chunk in
+// turn, so nothing is read before it's wanted.  Chunks are read straight
+// into the ReadChunk, at most maxChunk bytes each, and at most maxReads
+// run at once.  A read beyond that fails at once (setting busy) rather
+// than waiting, so reads in flight never hold more than maxChunk *
+// maxReads bytes however many are asked for.
+class ChunkReader : boost::noncopyable {
+public:
+    ChunkReader(std::size_t maxChunk, unsigned int maxReads);
+    ~ChunkReader();
+
+    std::size_t maxChunk() const { return m_maxChunk; }
+
+    // read up to maxBytes (at most maxChunk) of path from offset, which
+    // should be the start of a line.  the chunk ends after the last
+    // whole line read, unless it reaches the end of the file or a single
+    // line is longer than maxBytes.  the platform is told to start
+    // reading the chunk after it.  busy is set (and an error returned)
+    // if maxReads reads are already running.
+    std::string read(const boost::filesystem::path& path, boost::uint64_t offset,
+                     std::size_t maxBytes, ReadChunk& chunk, bool& busy);
+
+private:
+    bool begin();
+    void end();
+
+    std::size_t m_maxChunk;
+    unsigned int m_maxReads;
+    boost::mutex m_lock;
+    unsigned int m_reads;
+};
+
+}
+
+#endif
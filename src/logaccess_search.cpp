@@ -0,0 +1,255 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_search.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOGACCESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using logaccess::LineSearcher;
+using logaccess::SearchMatch;
+
+// longest line text handed back for a match
+static const std::size_t kMaxMatchText = 4096;
+
+static inline unsigned int
+popcount(unsigned int x) {
+#if defined(__GNUC__)
+    return __builtin_popcount(x);
+#elif defined(_MSC_VER)
+    return __popcnt(x);
+#else
+    unsigned int n = 0;
+    for (; x; x &= x - 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline unsigned int
+lowestBit(unsigned int x) {
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return i;
+#else
+    unsigned int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline char
+lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char) (c | 0x20) : c;
+}
+
+static inline bool
+isAlpha(char c) {
+    c = lower(c);
+    return c >= 'a' && c <= 'z';
+}
+
+static bool
+equalNoCase(const char* a, const char* b, std::size_t len) {
+    for (std::size_t i = 0; i < len; i++) {
+        if (lower(a[i]) != lower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+boost::uint64_t
+logaccess::countNewlines(const char* p, std::size_t len) {
+    boost::uint64_t n = 0;
+    std::size_t i = 0;
+#ifdef LOGACCESS_SSE2
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+        n += popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+    }
+#endif
+    for (; i < len; i++) {
+        n += (p[i] == '\n');
+    }
+    return n;
+}
+
+std::size_t
+logaccess::findNewlines(const char* p, std::size_t len,
+                        std::size_t* offsets, std::size_t max) {
+    std::size_t n = 0;
+    std::size_t i = 0;
+#ifdef LOGACCESS_SSE2
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= len && n < max; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (p + i));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        while (mask && n < max) {
+            offsets[n++] = i + lowestBit(mask);
+            mask &= mask - 1;
+        }
+    }
+    if (n == max) {
+        return n;
+    }
+#endif
+    for (; i < len && n < max; i++) {
+        if (p[i] == '\n') {
+            offsets[n++] = i;
+        }
+    }
+    return n;
+}
+
+LineSearcher::LineSearcher(const std::vector<std::string>& patterns, bool ignoreCase)
+    : m_ignoreCase(ignoreCase) {
+    for (std::vector<std::string>::const_iterator it = patterns.begin(); it != patterns.end(); ++it) {
+        if (it->empty()) {
+            continue;
+        }
+        std::string p = *it;
+        if (m_ignoreCase) {
+            std::transform(p.begin(), p.end(), p.begin(), lower);
+        }
+        m_patterns.push_back(p);
+    }
+}
+
+std::size_t
+LineSearcher::find(const std::string& p, const char* data,
+                   std::size_t len, std::size_t from) const {
+    const std::size_t m = p.size();
+    if (m > len || from > len - m) {
+        return len;
+    }
+    std::size_t i = from;
+    const std::size_t last = len - m;
+#ifdef LOGACCESS_SSE2
+    // compare 16 candidate starts at once.  when ignoring case a letter is
+    // matched by setting the 0x20 bit of the input before comparing
+    // against the lower case pattern byte.
+    const char f = p[0], l = p[m - 1];
+    const bool foldFirst = m_ignoreCase && isAlpha(f);
+    const bool foldLast = m_ignoreCase && isAlpha(l);
+    const __m128i first = _mm_set1_epi8(f);
+    const __m128i lastB = _mm_set1_epi8(l);
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const __m128i none = _mm_setzero_si128();
+    for (; i + 16 <= last + 1; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i b = _mm_loadu_si128((const __m128i*) (data + i + m - 1));
+        a = _mm_or_si128(a, foldFirst ? fold : none);
+        b = _mm_or_si128(b, foldLast ? fold : none);
+        unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                             _mm_cmpeq_epi8(b, lastB)));
+        while (mask) {
+            std::size_t pos = i + lowestBit(mask);
+            bool hit = m_ignoreCase ? equalNoCase(data + pos + 1, p.data() + 1, m - 1)
+                                    : !memcmp(data + pos + 1, p.data() + 1, m - 1);
+            if (hit) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i <= last; i++) {
+        bool hit = m_ignoreCase ? equalNoCase(data + i, p.data(), m)
+                                : !memcmp(data + i, p.data(), m);
+        if (hit) {
+            return i;
+        }
+    }
+    return len;
+}
+
+bool
+LineSearcher::search(const char* data, std::size_t len, std::size_t max,
+                     std::vector<SearchMatch>& matches) const {
+    boost::uint64_t line = 1;
+    return search(data, len, 0, line, max, matches);
+}
+
+bool
+LineSearcher::search(const char* data, std::size_t len, boost::uint64_t offset,
+                     boost::uint64_t& line, std::size_t max,
+                     std::vector<SearchMatch>& matches) const {
+    if (m_patterns.empty() || len == 0) {
+        line += countNewlines(data, len);
+        return true;
+    }
+    // next match of each pattern at or after pos.  every pattern is
+    // advanced past the line once a line has matched.
+    std::vector<std::size_t> next(m_patterns.size());
+    for (std::size_t i = 0; i < m_patterns.size(); i++) {
+        next[i] = find(m_patterns[i], data, len, 0);
+    }
+    std::size_t counted = 0;
+    for (;;) {
+        std::size_t hit = *std::min_element(next.begin(), next.end());
+        if (hit >= len) {
+            line += countNewlines(data + counted, len - counted);
+            return true;
+        }
+        if (matches.size() >= max) {
+            return false;
+        }
+        const char* nl = (const char*) memchr(data + hit, '\n', len - hit);
+        std::size_t end = nl ? (std::size_t) (nl - data) : len;
+        std::size_t start = hit;
+        while (start > counted && data[start - 1] != '\n') {
+            start--;
+        }
+        line += countNewlines(data + counted, start - counted);
+        counted = start;
+        SearchMatch sm;
+        sm.offset = offset + start;
+        sm.line = line;
+        sm.text.assign(data + start, std::min(end - start, kMaxMatchText));
+        if (!sm.text.empty() && sm.text[sm.text.size() - 1] == '\r') {
+            sm.text.erase(sm.text.size() - 1);
+        }
+        matches.push_back(sm);
+        for (std::size_t i = 0; i < m_patterns.size(); i++) {
+            if (next[i] <= end) {
+                next[i] = (end < len) ? find(m_patterns[i], data, len, end + 1) : len;
+            }
+        }
+    }
+}
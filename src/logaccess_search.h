@@ -0,0 +1,82 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_SEARCH_H__
+#define __LOGACCESS_SEARCH_H__
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+// number of '\n' bytes in [p, p + len)
+boost::uint64_t countNewlines(const char* p, std::size_t len);
+
+// store the offsets of the first max '\n' bytes in [p, p + len) in
+// offsets, returning how many there were.  fewer than max means
+// there are no more.
+std::size_t findNewlines(const char* p, std::size_t len,
+                         std::size_t* offsets, std::size_t max);
+
+struct SearchMatch {
+    // offset of the start of the matching line
+    boost::uint64_t offset;
+    // 1 based line number
+    boost::uint64_t line;
+    // the line, without its newline
+    std::string text;
+};
+
+// Finds lines containing any of a set of literal patterns.  Candidates
+// are found by comparing a pattern's first and last bytes against a
+// whole vector of input at once and only verified where both match.
+class LineSearcher {
+public:
+    LineSearcher(const std::vector<std::string>& patterns, bool ignoreCase);
+
+    // append lines of [data, data + len) matching any pattern to matches,
+    // in order, stopping once matches holds max entries.  returns false
+    // if it stopped early.
+    bool search(const char* data, std::size_t len, std::size_t max,
+                std::vector<SearchMatch>& matches) const;
+
+    // the same for a block of whole lines of a larger file, which starts
+    // at offset in the file and on line number line.  line is advanced
+    // past the block.
+    bool search(const char* data, std::size_t len, boost::uint64_t offset,
+                boost::uint64_t& line, std::size_t max,
+                std::vector<SearchMatch>& matches) const;
+
+private:
+    // offset of the first match of pattern p at or after from, or len
+    std::size_t find(const std::string& p, const char* data,
+                     std::size_t len, std::size_t from) const;
+
+    std::vector<std::string> m_patterns;
+    bool m_ignoreCase;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_sha1.h"
+#include <cstring>
+
+using logaccess::Sha1;
+
+static inline boost::uint32_t
+rotl(boost::uint32_t x, unsigned int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+Sha1::Sha1() : m_length(0), m_used(0) {
+    m_h[0] = 0x67452301;
+    m_h[1] = 0xEFCDAB89;
+    m_h[2] = 0x98BADCFE;
+    m_h[3] = 0x10325476;
+    m_h[4] = 0xC3D2E1F0;
+}
+
+void
+Sha1::block(const unsigned char* p) {
+    boost::uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((boost::uint32_t) p[4 * i] << 24) | ((boost::uint32_t) p[4 * i + 1] << 16)
+            | ((boost::uint32_t) p[4 * i + 2] << 8) | (boost::uint32_t) p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    boost::uint32_t a = m_h[0], b = m_h[1], c = m_h[2], d = m_h[3], e = m_h[4];
+    for (int i = 0; i < 80; i++) {
+        boost::uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        boost::uint32_t t = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = t;
+    }
+    m_h[0] += a;
+    m_h[1] += b;
+    m_h[2] += c;
+    m_h[3] += d;
+    m_h[4] += e;
+}
+
+void
+Sha1::update(const char* p, std::size_t len) {
+    const unsigned char* u = (const unsigned char*) p;
+    m_length += len;
+    if (m_used > 0) {
+        std::size_t n = len < 64 - m_used ? len : 64 - m_used;
+        memcpy(m_buf + m_used, u, n);
+        m_used += n;
+        u += n;
+        len -= n;
+        if (m_used < 64) {
+            return;
+        }
+        block(m_buf);
+        m_used = 0;
+    }
+    while (len >= 64) {
+        block(u);
+        u += 64;
+        len -= 64;
+    }
+    memcpy(m_buf, u, len);
+    m_used = len;
+}
+
+std::string
+Sha1::hexDigest() {
+    boost::uint64_t bits = m_length * 8;
+    static const char pad[64] = { (char) 0x80 };
+    update(pad, m_used < 56 ? 56 - m_used : 120 - m_used);
+    unsigned char len[8];
+    for (int i = 0; i < 8; i++) {
+        len[i] = (unsigned char) (bits >> (56 - 8 * i));
+    }
+    update((const char*) len, 8);
+    static const char hex[] = "0123456789abcdef";
+    std::string digest(40, '0');
+    for (int i = 0; i < 20; i++) {
+        unsigned char byte = (unsigned char) (m_h[i / 4] >> (24 - 8 * (i % 4)));
+        digest[2 * i] = hex[byte >> 4];
+        digest[2 * i + 1] = hex[byte & 15];
+    }
+    *this = Sha1();
+    return digest;
+}
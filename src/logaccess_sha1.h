@@ -0,0 +1,54 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_SHA1_H__
+#define __LOGACCESS_SHA1_H__
+
+#include <boost/cstdint.hpp>
+#include <cstddef>
+#include <string>
+
+namespace logaccess {
+
+// SHA-1 (FIPS 180-1), fed incrementally
+class Sha1 {
+public:
+    Sha1();
+
+    void update(const char* p, std::size_t len);
+
+    // the digest as 40 lower case hex digits, after which the Sha1
+    // starts over
+    std::string hexDigest();
+
+private:
+    void block(const unsigned char* p);
+
+    boost::uint32_t m_h[5];
+    boost::uint64_t m_length;
+    unsigned char m_buf[64];
+    std::size_t m_used;
+};
+
+}
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_signatures.h"
+#include "logaccess_file.h"
+#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+using logaccess::SignatureHit;
+using logaccess::Signatures;
+
+// bytes read from a logfile at once
+static const std::size_t kScanBlock = 256 * 1024;
+
+static inline unsigned char
+lower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char) (c - 'A' + 'a') : c;
+}
+
+Signatures::Signatures() : m_numClasses(1) {
+    memset(m_classes, 0, sizeof(m_classes));
+}
+
+void
+Signatures::add(const std::string& id, const std::string& pattern) {
+    if (id.empty() || pattern.empty()) {
+        return;
+    }
+    Pattern p;
+    p.text = pattern;
+    p.signature = std::find(m_ids.begin(), m_ids.end(), id) - m_ids.begin();
+    if (p.signature == m_ids.size()) {
+        m_ids.push_back(id);
+    }
+    m_patterns.push_back(p);
+}
+
+bool
+Signatures::load(const boost::filesystem::path& file) {
+    boost::filesystem::ifstream is(file);
+    if (!is) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(is, line)) {
+        std::string::size_type b = line.find_first_not_of(" \t\r");
+        if (b == std::string::npos || line[b] == '#') {
+            continue;
+        }
+        std::string::size_type idEnd = line.find_first_of(" \t", b);
+        if (idEnd == std::string::npos) {
+            continue;
+        }
+        std::string::size_type pb = line.find_first_not_of(" \t", idEnd);
+        std::string::size_type pe = line.find_last_not_of(" \t\r");
+        if (pb == std::string::npos) {
+            continue;
+        }
+        add(line.substr(b, idEnd - b), line.substr(pb, pe - pb + 1));
+    }
+    return true;
+}
+
+void
+Signatures::compile() {
+    // a class for each (lower cased) byte the patterns use
+    memset(m_classes, 0, sizeof(m_classes));
+    m_numClasses = 1;
+    for (std::vector<Pattern>::const_iterator p = m_patterns.begin(); p != m_patterns.end(); ++p) {
+        for (std::string::const_iterator c = p->text.begin(); c != p->text.end(); ++c) {
+            unsigned char l = lower((unsigned char) *c);
+            if (!m_classes[l]) {
+                m_classes[l] = (unsigned char) m_numClasses++;
+            }
+        }
+    }
+    for (unsigned int c = 'A'; c <= 'Z'; c++) {
+        m_classes[c] = m_classes[lower((unsigned char) c)];
+    }
+
+    // the trie of the patterns, 0 meaning no edge (the root is never a
+    // child)
+    const unsigned int n = m_numClasses;
+    m_next.assign(n, 0);
+    std::vector<std::vector<unsigned int> > matches(1);
+    for (unsigned int i = 0; i < m_patterns.size(); i++) {
+        unsigned int s = 0;
+        const std::string& text = m_patterns[i].text;
+        for (std::string::const_iterator c = text.begin(); c != text.end(); ++c) {
+            unsigned int& t = m_next[s * n + m_classes[(unsigned char) *c]];
+            if (!t) {
+                t = (unsigned int) matches.size();
+                matches.push_back(std::vector<unsigned int>());
+                m_next.resize(m_next.size() + n, 0);
+            }
+            // m_next may have moved, so don't keep t
+            s = m_next[s * n + m_classes[(unsigned char) *c]];
+        }
+        matches[s].push_back(i);
+    }
+
+    // breadth first, point each missing edge where the failure link
+    // would lead and collect the matches along the failure chain
+    std::vector<unsigned int> fail(matches.size(), 0);
+    std::deque<unsigned int> queue;
+    for (unsigned int c = 0; c < n; c++) {
+        if (m_next[c]) {
+            queue.push_back(m_next[c]);
+        }
+    }
+    while (!queue.empty()) {
+        unsigned int s = queue.front();
+        queue.pop_front();
+        const std::vector<unsigned int>& inherited = matches[fail[s]];
+        matches[s].insert(matches[s].end(), inherited.begin(), inherited.end());
+        for (unsigned int c = 0; c < n; c++) {
+            unsigned int& t = m_next[s * n + c];
+            if (t) {
+                fail[t] = m_next[fail[s] * n + c];
+                queue.push_back(t);
+            } else {
+                t = m_next[fail[s] * n + c];
+            }
+        }
+    }
+
+    m_matchStart.assign(1, 0);
+    m_matches.clear();
+    for (std::vector<std::vector<unsigned int> >::const_iterator m = matches.begin(); m != matches.end(); ++m) {
+        m_matches.insert(m_matches.end(), m->begin(), m->end());
+        m_matchStart.push_back((unsigned int) m_matches.size());
+    }
+}
+
+std::string
+Signatures::scan(const boost::filesystem::path& path,
+                 std::vector<SignatureHit>& hits) const {
+    hits.clear();
+    File file;
+    if (!file.open(path)) {
+        return std::string("unable to read ") + path.string();
+    }
+    std::vector<SignatureHit> found(m_ids.size());
+    for (std::size_t i = 0; i < found.size(); i++) {
+        found[i].signature = i;
+        found[i].count = 0;
+        found[i].first = found[i].last = 0;
+    }
+    if (m_matchStart.empty()) {
+        return std::string();
+    }
+    const unsigned int n = m_numClasses;
+    const unsigned int* next = m_next.empty() ? NULL : &m_next[0];
+    std::vector<char> buf(kScanBlock);
+    boost::uint64_t offset = 0;
+    unsigned int s = 0;
+    for (;;) {
+        long long got = file.readAt(offset, &buf[0], buf.size());
+        if (got < 0) {
+            return std::string("unable to read ") + path.string();
+        }
+        if (got == 0) {
+            break;
+        }
+        for (long long i = 0; i < got; i++) {
+            s = next[s * n + m_classes[(unsigned char) buf[i]]];
+            if (m_matchStart[s] == m_matchStart[s + 1]) {
+                continue;
+            }
+            boost::uint64_t end = offset + i + 1;
+            for (unsigned int m = m_matchStart[s]; m < m_matchStart[s + 1]; m++) {
+                const Pattern& p = m_patterns[m_matches[m]];
+                SignatureHit& h = found[p.signature];
+                boost::uint64_t start = end - p.text.size();
+                if (h.count == 0 || start < h.first) {
+                    h.first = start;
+                }
+                if (h.count == 0 || start > h.last) {
+                    h.last = start;
+                }
+                h.count++;
+            }
+        }
+        offset += got;
+    }
+    for (std::vector<SignatureHit>::const_iterator it = found.begin(); it != found.end(); ++it) {
+        if (it->count) {
+            hits.push_back(*it);
+        }
+    }
+    return std::string();
+}
@@ -0,0 +1,93 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_SIGNATURES_H__
+#define __LOGACCESS_SIGNATURES_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct SignatureHit {
+    // index of the signature, see Signatures::id()
+    std::size_t signature;
+    boost::uint64_t count;
+    // offsets of the start of the first and last matches
+    boost::uint64_t first;
+    boost::uint64_t last;
+};
+
+// A catalog of known failures, each an id and one or more literal
+// patterns matched ignoring case.  Once compiled the patterns form a
+// single Aho-Corasick automaton, flattened into a transition table
+// over the bytes the patterns use, so a scan costs one table lookup
+// per byte however many patterns there are.
+class Signatures {
+public:
+    Signatures();
+
+    // add a pattern for signature id, a new signature if id is new
+    void add(const std::string& id, const std::string& pattern);
+
+    // add the signatures listed in file, an id and a pattern per line
+    // separated by whitespace.  blank lines and lines starting with '#'
+    // are ignored.
+    bool load(const boost::filesystem::path& file);
+
+    // build the automaton, needed after adding before scanning
+    void compile();
+
+    std::size_t size() const { return m_ids.size(); }
+    const std::string& id(std::size_t signature) const { return m_ids[signature]; }
+
+    // scan the logfile at path once, setting hits to the signatures
+    // found, in signature order
+    std::string scan(const boost::filesystem::path& path,
+                     std::vector<SignatureHit>& hits) const;
+
+private:
+    struct Pattern {
+        std::string text;
+        std::size_t signature;
+    };
+
+    std::vector<std::string> m_ids;
+    std::vector<Pattern> m_patterns;
+
+    // byte -> class, bytes in no pattern are class 0
+    unsigned char m_classes[256];
+    unsigned int m_numClasses;
+    // state * m_numClasses + class -> next state, state 0 is the root
+    std::vector<unsigned int> m_next;
+    // the patterns ending at state s are
+    // m_matches[m_matchStart[s] .. m_matchStart[s + 1])
+    std::vector<unsigned int> m_matchStart;
+    std::vector<unsigned int> m_matches;
+};
+
+}
+
+#endif
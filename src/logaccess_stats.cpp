@@ -0,0 +1,258 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_stats.h"
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <cstring>
+
+using logaccess::stats::Attach;
+using logaccess::stats::Call;
+using logaccess::stats::Totals;
+
+namespace {
+    // one thread's counts.  slots are never freed, a thread that exits
+    // hands its slot (and counts) on to the next one to start counting.
+    // methods is written only by the owner, with no lock, and read by
+    // sumSlots() while the owner may be writing: a sum can be a count
+    // or so behind, and on 32 bit builds a read can catch a 64 bit
+    // counter half written.  the padding keeps the counters off cache
+    // lines shared with whatever the heap put either side of the slot.
+    struct Slot {
+        Slot() : current(logaccess::stats::kOther), free(false) {}
+        char padBefore[64];
+        Totals methods[logaccess::stats::kNumMethods];
+        logaccess::stats::Method current;
+        bool free;
+        char padAfter[64];
+    };
+
+    void releaseSlot(Slot* slot);
+
+    boost::mutex s_lock;
+    std::vector<Slot*> s_slots;
+    // totals at the last reset
+    std::vector<Totals> s_baseline(logaccess::stats::kNumMethods);
+    boost::thread_specific_ptr<Slot> s_mySlot(releaseSlot);
+
+    void releaseSlot(Slot* slot) {
+        boost::mutex::scoped_lock lock(s_lock);
+        slot->current = logaccess::stats::kOther;
+        slot->free = true;
+    }
+
+    Slot* mySlot() {
+        Slot* slot = s_mySlot.get();
+        if (slot) {
+            return slot;
+        }
+        {
+            boost::mutex::scoped_lock lock(s_lock);
+            for (std::vector<Slot*>::const_iterator it = s_slots.begin(); it != s_slots.end(); ++it) {
+                if ((*it)->free) {
+                    slot = *it;
+                    slot->free = false;
+                    break;
+                }
+            }
+            if (!slot) {
+                slot = new Slot;
+                s_slots.push_back(slot);
+            }
+        }
+        s_mySlot.reset(slot);
+        return slot;
+    }
+
+    // what's been counted since base, 0 rather than wrapping if a torn
+    // read left base ahead of now
+    void since(boost::uint64_t& now, boost::uint64_t base) {
+        now = now > base ? now - base : 0;
+    }
+
+    // sum of all slots, s_lock held
+    void sumSlots(std::vector<Totals>& out) {
+        out.assign(logaccess::stats::kNumMethods, Totals());
+        for (std::vector<Slot*>::const_iterator it = s_slots.begin(); it != s_slots.end(); ++it) {
+            for (unsigned int m = 0; m < logaccess::stats::kNumMethods; m++) {
+                const Totals& from = (*it)->methods[m];
+                Totals& to = out[m];
+                to.calls += from.calls;
+                to.timeUs += from.timeUs;
+                for (unsigned int i = 0; i < logaccess::stats::kNumCounters; i++) {
+                    to.counters[i] += from.counters[i];
+                }
+                for (unsigned int i = 0; i < logaccess::stats::kNumErrors; i++) {
+                    to.errors[i] += from.errors[i];
+                }
+                for (unsigned int i = 0; i < logaccess::stats::kNumBuckets; i++) {
+                    to.buckets[i] += from.buckets[i];
+                }
+            }
+        }
+    }
+}
+
+Totals::Totals() : calls(0), timeUs(0) {
+    memset(counters, 0, sizeof(counters));
+    memset(errors, 0, sizeof(errors));
+    memset(buckets, 0, sizeof(buckets));
+}
+
+const char*
+logaccess::stats::methodName(Method m) {
+    static const char* names[kNumMethods] = {
+        "get", "getServiceLogs", "tail", "grep", "follow", "getBundle",
+        "range", "query", "timeline", "summary", "diagnose", "manifest",
+        "fetchChunks", "read", "stats", "warmUp", "other"
+    };
+    return names[m];
+}
+
+const char*
+logaccess::stats::counterName(Counter c) {
+    static const char* names[kNumCounters] = {
+        "dirsOpened", "entriesScanned", "statCalls", "bytesRead",
+        "cacheHits", "cacheMisses"
+    };
+    return names[c];
+}
+
+const char*
+logaccess::stats::errorName(Error e) {
+    static const char* names[kNumErrors] = {
+        "bp.permissionDenied", "bp.couldntGetLogs", "bp.invalidArguments", "bp.busy",
+        "other"
+    };
+    return names[e];
+}
+
+void
+logaccess::stats::count(Counter c, boost::uint64_t n) {
+    Slot* slot = mySlot();
+    slot->methods[slot->current].counters[c] += n;
+}
+
+void
+logaccess::stats::error(const char* code) {
+    Error e = kOtherError;
+    for (unsigned int i = 0; i < kOtherError; i++) {
+        if (code && !strcmp(code, errorName((Error) i))) {
+            e = (Error) i;
+            break;
+        }
+    }
+    Slot* slot = mySlot();
+    slot->methods[slot->current].errors[e]++;
+}
+
+logaccess::stats::Method
+logaccess::stats::current() {
+    return mySlot()->current;
+}
+
+Attach::Attach(Method m) {
+    Slot* slot = mySlot();
+    m_previous = slot->current;
+    slot->current = m;
+}
+
+Attach::~Attach() {
+    mySlot()->current = m_previous;
+}
+
+Call::Call(Method m)
+    : m_method(m), m_attach(m),
+      m_start(boost::posix_time::microsec_clock::universal_time()), m_deferred(false) {
+}
+
+Call::~Call() {
+    if (!m_deferred) {
+        record(m_method, m_start);
+    }
+}
+
+void
+logaccess::stats::record(Method m, const boost::posix_time::ptime& start) {
+    long long us = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds();
+    if (us < 0) {
+        us = 0;
+    }
+    unsigned int b = 0;
+    while (b + 1 < kNumBuckets && (1ULL << b) <= (unsigned long long) us) {
+        b++;
+    }
+    Slot* slot = mySlot();
+    Totals& t = slot->methods[m];
+    t.calls++;
+    t.timeUs += us;
+    t.buckets[b]++;
+}
+
+boost::uint64_t
+logaccess::stats::percentileUs(const Totals& t, double p) {
+    boost::uint64_t calls = 0;
+    for (unsigned int b = 0; b < kNumBuckets; b++) {
+        calls += t.buckets[b];
+    }
+    if (calls == 0) {
+        return 0;
+    }
+    boost::uint64_t want = (boost::uint64_t) (p * calls + 0.999999);
+    boost::uint64_t seen = 0;
+    for (unsigned int b = 0; b < kNumBuckets; b++) {
+        seen += t.buckets[b];
+        if (seen >= want) {
+            return 1ULL << b;
+        }
+    }
+    return 1ULL << (kNumBuckets - 1);
+}
+
+void
+logaccess::stats::totals(std::vector<Totals>& out) {
+    boost::mutex::scoped_lock lock(s_lock);
+    sumSlots(out);
+    for (unsigned int m = 0; m < kNumMethods; m++) {
+        const Totals& base = s_baseline[m];
+        Totals& t = out[m];
+        since(t.calls, base.calls);
+        since(t.timeUs, base.timeUs);
+        for (unsigned int i = 0; i < kNumCounters; i++) {
+            since(t.counters[i], base.counters[i]);
+        }
+        for (unsigned int i = 0; i < kNumErrors; i++) {
+            since(t.errors[i], base.errors[i]);
+        }
+        for (unsigned int i = 0; i < kNumBuckets; i++) {
+            since(t.buckets[i], base.buckets[i]);
+        }
+    }
+}
+
+void
+logaccess::stats::reset() {
+    // slots belong to their threads, rather than clear them behind
+    // their backs remember where they stood
+    boost::mutex::scoped_lock lock(s_lock);
+    sumSlots(s_baseline);
+}
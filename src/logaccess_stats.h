@@ -0,0 +1,155 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_STATS_H__
+#define __LOGACCESS_STATS_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/utility.hpp>
+#include <vector>
+
+namespace logaccess {
+namespace stats {
+
+// Counters and latency histograms kept per service method.  Each
+// thread counts into a slot of its own without taking a lock.  Reading
+// sums the slots without stopping their owners, so totals may miss the
+// latest counts.  Counts are process wide, all service instances share
+// them.
+
+enum Method {
+    kGet,
+    kGetServiceLogs,
+    kTail,
+    kGrep,
+    kFollow,
+    kGetBundle,
+    kRange,
+    kQuery,
+    kTimeline,
+    kSummary,
+    kDiagnose,
+    kManifest,
+    kFetchChunks,
+    kRead,
+    kStats,
+    // discovery done ahead of anyone asking
+    kWarmUp,
+    // work done outside any method
+    kOther,
+    kNumMethods
+};
+
+enum Counter {
+    kDirsOpened,
+    kEntriesScanned,
+    kStatCalls,
+    kBytesRead,
+    kCacheHits,
+    kCacheMisses,
+    kNumCounters
+};
+
+// error codes we hand to transactions, anything else is counted as
+// kOtherError
+enum Error {
+    kPermissionDenied,
+    kCouldntGetLogs,
+    kInvalidArguments,
+    kBusy,
+    kOtherError,
+    kNumErrors
+};
+
+// latency buckets, bucket b holds calls taking less than 2^b
+// microseconds (and at least 2^(b-1))
+static const unsigned int kNumBuckets = 32;
+
+const char* methodName(Method m);
+const char* counterName(Counter c);
+const char* errorName(Error e);
+
+// add n to counter c of the method the calling thread works for
+void count(Counter c, boost::uint64_t n = 1);
+
+// count an error reported by the method the calling thread works for
+void error(const char* code);
+
+// the method the calling thread works for, kOther outside any
+Method current();
+
+// Makes the calling thread work for a method until destroyed, without
+// counting a call.  For threads a method hands work to.
+class Attach : boost::noncopyable {
+public:
+    explicit Attach(Method m);
+    ~Attach();
+private:
+    Method m_previous;
+};
+
+// A call of a method: the calling thread works for m until destroyed,
+// when the call and its wall time are counted.
+class Call : boost::noncopyable {
+public:
+    explicit Call(Method m);
+    ~Call();
+
+    const boost::posix_time::ptime& start() const { return m_start; }
+
+    // the call goes on elsewhere, whoever finishes it calls record()
+    void defer() { m_deferred = true; }
+
+private:
+    Method m_method;
+    Attach m_attach;
+    boost::posix_time::ptime m_start;
+    bool m_deferred;
+};
+
+// count a call of m that began at start and has just finished
+void record(Method m, const boost::posix_time::ptime& start);
+
+struct Totals {
+    Totals();
+    boost::uint64_t calls;
+    boost::uint64_t timeUs;
+    boost::uint64_t counters[kNumCounters];
+    boost::uint64_t errors[kNumErrors];
+    boost::uint64_t buckets[kNumBuckets];
+};
+
+// the upper bound in microseconds of the bucket holding the fraction p
+// (0 < p <= 1) of the calls counted in t, 0 if there are none
+boost::uint64_t percentileUs(const Totals& t, double p);
+
+// totals since the last reset, indexed by Method
+void totals(std::vector<Totals>& out);
+
+// start counting from zero
+void reset();
+
+}
+}
+
+#endif
@@ -0,0 +1,343 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_summary.h"
+#include "logaccess_file.h"
+#include "logaccess_pool.h"
+#include "logaccess_search.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cstring>
+
+using logaccess::LogSummary;
+using logaccess::MessageCount;
+
+// chunks are at least this big, smaller files aren't worth splitting
+static const std::size_t kMinChunk = 256 * 1024;
+// chunks per core, so a slow chunk doesn't hold everyone up
+static const unsigned int kChunksPerCore = 4;
+// longest normalized message kept, the rest is dropped.  this bounds
+// what each distinct message costs, the tables hold every one of them
+// so the counts are exact.
+static const std::size_t kMaxMessage = 160;
+// newlines located per call of findNewlines
+static const std::size_t kNewlineBatch = 1024;
+// how much of its chunk each task reads at a time
+static const std::size_t kReadBlock = 256 * 1024;
+
+LogSummary::LogSummary() : size(0), lines(0), haveTimes(false), first(0), last(0), distinct(0) {
+    memset(levels, 0, sizeof(levels));
+}
+
+static inline bool
+isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool
+isHexDigit(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline bool
+isWordChar(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// copy [p, end) to out (at most kMaxMessage bytes) replacing runs of
+// digits, "0x" numbers and words of hex digits holding a digit (ids,
+// addresses, hashes) with '#'.  returns the length written.
+static std::size_t
+normalize(const char* p, const char* end, char* out) {
+    std::size_t n = 0;
+    bool wordStart = true;
+    while (p < end && n < kMaxMessage) {
+        char c = *p;
+        if (wordStart && isHexDigit(c)) {
+            const char* q = p;
+            if (c == '0' && q + 2 < end && (q[1] == 'x' || q[1] == 'X') && isHexDigit(q[2])) {
+                q += 2;
+            }
+            bool digit = false;
+            const char* h = q;
+            while (h < end && isHexDigit(*h)) {
+                digit = digit || isDigit(*h);
+                h++;
+            }
+            if (digit && (h == end || !isWordChar(*h))) {
+                out[n++] = '#';
+                p = h;
+                wordStart = false;
+                continue;
+            }
+        }
+        if (isDigit(c)) {
+            while (p < end && isDigit(*p)) {
+                p++;
+            }
+            out[n++] = '#';
+            wordStart = false;
+            continue;
+        }
+        out[n++] = c;
+        wordStart = !isWordChar(c);
+        p++;
+    }
+    while (n > 0 && (out[n - 1] == ' ' || out[n - 1] == '\r' || out[n - 1] == '\t')) {
+        n--;
+    }
+    return n;
+}
+
+static inline boost::uint64_t
+hashBytes(const char* p, std::size_t len) {
+    boost::uint64_t h = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < len; i++) {
+        h ^= (unsigned char) p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+namespace {
+    // open addressed message -> count table, one per chunk so counting
+    // never needs a lock
+    class MessageTable {
+    public:
+        MessageTable() : m_used(0), m_slots(1024) {}
+
+        void add(const char* p, std::size_t len, boost::uint64_t hash, boost::uint64_t count) {
+            std::size_t mask = m_slots.size() - 1;
+            for (std::size_t i = (std::size_t) hash & mask; ; i = (i + 1) & mask) {
+                Slot& s = m_slots[i];
+                if (s.count == 0) {
+                    s.hash = hash;
+                    s.count = count;
+                    s.message.assign(p, len);
+                    if (++m_used * 2 > m_slots.size()) {
+                        grow();
+                    }
+                    return;
+                }
+                if (s.hash == hash && s.message.size() == len
+                    && !memcmp(s.message.data(), p, len)) {
+                    s.count += count;
+                    return;
+                }
+            }
+        }
+
+        void merge(const MessageTable& other) {
+            for (std::vector<Slot>::const_iterator it = other.m_slots.begin(); it != other.m_slots.end(); ++it) {
+                if (it->count) {
+                    add(it->message.data(), it->message.size(), it->hash, it->count);
+                }
+            }
+        }
+
+        std::size_t size() const { return m_used; }
+
+        void top(std::size_t n, std::vector<MessageCount>& out) const {
+            std::vector<MessageCount> all;
+            for (std::vector<Slot>::const_iterator it = m_slots.begin(); it != m_slots.end(); ++it) {
+                if (it->count) {
+                    MessageCount mc;
+                    mc.message = it->message;
+                    mc.count = it->count;
+                    all.push_back(mc);
+                }
+            }
+            n = std::min(n, all.size());
+            std::partial_sort(all.begin(), all.begin() + n, all.end(), moreFrequent);
+            out.assign(all.begin(), all.begin() + n);
+        }
+
+    private:
+        struct Slot {
+            Slot() : hash(0), count(0) {}
+            boost::uint64_t hash;
+            boost::uint64_t count;
+            std::string message;
+        };
+
+        static bool moreFrequent(const MessageCount& a, const MessageCount& b) {
+            return a.count != b.count ? a.count > b.count : a.message < b.message;
+        }
+
+        void grow() {
+            std::vector<Slot> old(m_slots.size() * 2);
+            old.swap(m_slots);
+            std::size_t mask = m_slots.size() - 1;
+            for (std::vector<Slot>::iterator it = old.begin(); it != old.end(); ++it) {
+                if (!it->count) {
+                    continue;
+                }
+                std::size_t i = (std::size_t) it->hash & mask;
+                while (m_slots[i].count) {
+                    i = (i + 1) & mask;
+                }
+                m_slots[i].hash = it->hash;
+                m_slots[i].count = it->count;
+                m_slots[i].message.swap(it->message);
+            }
+        }
+
+        std::size_t m_used;
+        std::vector<Slot> m_slots;
+    };
+
+    // the lines starting in [begin, end) of the file
+    struct Chunk {
+        Chunk() : begin(0), end(0), failed(false) {}
+        boost::uint64_t begin;
+        boost::uint64_t end;
+        bool failed;
+        LogSummary summary;
+        MessageTable messages;
+    };
+}
+
+static void
+summarizeLine(const char* p, const char* end, Chunk& chunk) {
+    chunk.summary.lines++;
+    logaccess::LineFields f;
+    if (!logaccess::parseLine(p, end, f)) {
+        return;
+    }
+    LogSummary& s = chunk.summary;
+    s.levels[f.level]++;
+    if (!s.haveTimes) {
+        s.haveTimes = true;
+        s.first = s.last = f.time;
+    } else {
+        s.first = std::min(s.first, f.time);
+        s.last = std::max(s.last, f.time);
+    }
+    char buf[kMaxMessage];
+    std::size_t len = normalize(f.message, end, buf);
+    if (len > 0) {
+        chunk.messages.add(buf, len, hashBytes(buf, len), 1);
+    }
+}
+
+static void
+summarizeChunk(const logaccess::File& file, boost::uint64_t size,
+               std::vector<Chunk>& chunks, unsigned int i) {
+    Chunk& chunk = chunks[i];
+    // a line starts at begin only if the byte before it is a newline,
+    // otherwise the line in progress there belongs to the chunk before.
+    // skipping is also set after the part of a line too long for a
+    // block, its rest is skipped the same way.
+    bool skipping = chunk.begin > 0;
+    logaccess::LineBlockReader blocks(file, skipping ? chunk.begin - 1 : 0, size, kReadBlock);
+    const char* data;
+    std::size_t len;
+    boost::uint64_t offset;
+    std::size_t offsets[kNewlineBatch];
+    while (blocks.next(data, len, offset)) {
+        const char* p = data;
+        const char* end = data + len;
+        if (skipping) {
+            const char* nl = (const char*) memchr(p, '\n', len);
+            if (!nl) {
+                continue;
+            }
+            p = nl + 1;
+            skipping = false;
+        }
+        while (p < end) {
+            std::size_t n = logaccess::findNewlines(p, end - p, offsets, kNewlineBatch);
+            const char* line = p;
+            for (std::size_t j = 0; j < n; j++) {
+                if (offset + (line - data) >= chunk.end) {
+                    return;
+                }
+                const char* nl = p + offsets[j];
+                summarizeLine(line, nl, chunk);
+                line = nl + 1;
+            }
+            if (n < kNewlineBatch) {
+                // the start of a line longer than a block, or a last
+                // line without a newline
+                if (line < end) {
+                    if (offset + (line - data) >= chunk.end) {
+                        return;
+                    }
+                    summarizeLine(line, end, chunk);
+                    skipping = true;
+                }
+                break;
+            }
+            p = line;
+        }
+    }
+    chunk.failed = blocks.failed();
+}
+
+std::string
+logaccess::summarize(const boost::filesystem::path& path, std::size_t top,
+                     LogSummary& summary) {
+    summary = LogSummary();
+    File file;
+    boost::uint64_t size = 0;
+    if (!file.open(path) || !file.size(size)) {
+        return std::string("unable to read ") + path.string();
+    }
+    summary.size = size;
+    if (size == 0) {
+        return std::string();
+    }
+    // split into near equal fractions of the file, each task finds the
+    // line starts in its own
+    std::size_t count = (std::size_t) std::max<boost::uint64_t>(1, std::min<boost::uint64_t>(
+        size / kMinChunk, pool::concurrency() * kChunksPerCore));
+    std::vector<Chunk> chunks(count);
+    for (std::size_t i = 0; i < count; i++) {
+        chunks[i].begin = size / count * i;
+        chunks[i].end = (i + 1 == count) ? size : size / count * (i + 1);
+    }
+    pool::parallelFor(count, boost::bind(summarizeChunk, boost::cref(file), size,
+                                         boost::ref(chunks), _1));
+
+    MessageTable& messages = chunks[0].messages;
+    for (std::size_t i = 0; i < count; i++) {
+        const LogSummary& s = chunks[i].summary;
+        summary.lines += s.lines;
+        for (int l = 0; l < kNumLevels; l++) {
+            summary.levels[l] += s.levels[l];
+        }
+        if (s.haveTimes) {
+            summary.first = summary.haveTimes ? std::min(summary.first, s.first) : s.first;
+            summary.last = summary.haveTimes ? std::max(summary.last, s.last) : s.last;
+            summary.haveTimes = true;
+        }
+        if (i > 0) {
+            messages.merge(chunks[i].messages);
+        }
+        if (chunks[i].failed) {
+            return std::string("unable to read ") + path.string();
+        }
+    }
+    summary.distinct = messages.size();
+    messages.top(top, summary.top);
+    return std::string();
+}
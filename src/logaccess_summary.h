@@ -0,0 +1,65 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_SUMMARY_H__
+#define __LOGACCESS_SUMMARY_H__
+
+#include "logaccess_line.h"
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct MessageCount {
+    // the message with runs of digits and hex numbers replaced by '#'
+    std::string message;
+    boost::uint64_t count;
+};
+
+struct LogSummary {
+    LogSummary();
+    boost::uint64_t size;
+    boost::uint64_t lines;
+    // lines starting with a timestamp, by level
+    boost::uint64_t levels[kNumLevels];
+    // earliest and latest timestamps, only meaningful if haveTimes
+    bool haveTimes;
+    boost::int64_t first;
+    boost::int64_t last;
+    // number of different messages, and the most frequent of them, most
+    // frequent first.  counts are exact.
+    boost::uint64_t distinct;
+    std::vector<MessageCount> top;
+};
+
+// Summarize the logfile at path, keeping its top most frequent
+// messages.  The file is split into chunks of whole lines that are
+// read and summarized in parallel, each into its own table of messages,
+// which are merged at the end.
+std::string summarize(const boost::filesystem::path& path, std::size_t top,
+                      LogSummary& summary);
+
+}
+
+#endif
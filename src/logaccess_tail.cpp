@@ -0,0 +1,93 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_tail.h"
+#include "logaccess_file.h"
+#include <algorithm>
+#include <vector>
+
+// how much is read per step while looking for line starts
+static const std::size_t kTailBlockSize = 64 * 1024;
+
+std::string
+logaccess::tail(const boost::filesystem::path& path, boost::uint64_t lines,
+                boost::uint64_t bytes, TailResult& result) {
+    File file;
+    if (!file.open(path)) {
+        return std::string("unable to open ") + path.string();
+    }
+    boost::uint64_t size = 0;
+    if (!file.size(size)) {
+        return std::string("unable to get size of ") + path.string();
+    }
+    result.size = size;
+    if (bytes == 0 || bytes > kMaxTailBytes) {
+        bytes = kMaxTailBytes;
+    }
+    boost::uint64_t start = size > bytes ? size - bytes : 0;
+    bool clipped = (start > 0);
+    if (lines > 0 && size > 0) {
+        // a newline as the very last byte ends the last line rather than
+        // starting a new one, so the search starts just before it.
+        std::vector<char> block(kTailBlockSize);
+        boost::uint64_t end = size - 1;
+        boost::uint64_t found = 0;
+        bool done = false;
+        while (!done && end > start) {
+            std::size_t len = (std::size_t) std::min<boost::uint64_t>(kTailBlockSize, end - start);
+            boost::uint64_t blockStart = end - len;
+            long long n = file.readAt(blockStart, &block[0], len);
+            if (n != (long long) len) {
+                return std::string("unable to read ") + path.string();
+            }
+            for (std::size_t i = len; i > 0; i--) {
+                if (block[i - 1] == '\n' && ++found == lines) {
+                    start = blockStart + i;
+                    clipped = false;
+                    done = true;
+                    break;
+                }
+            }
+            end = blockStart;
+        }
+    }
+    if (!file.read(start, (std::size_t) (size - start), result.data)) {
+        return std::string("unable to read ") + path.string();
+    }
+    result.offset = start;
+    if (clipped && lines > 0) {
+        char before = 0;
+        if (file.readAt(start - 1, &before, 1) == 1 && before == '\n') {
+            clipped = false;
+        }
+    }
+    if (clipped && lines > 0) {
+        // hit the byte limit before enough lines, don't hand back the
+        // partial line the limit landed in.
+        std::string::size_type nl = result.data.find('\n');
+        if (nl != std::string::npos && nl + 1 < result.data.size()) {
+            result.data.erase(0, nl + 1);
+            result.offset += nl + 1;
+        }
+    }
+    return std::string();
+}
@@ -0,0 +1,53 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_TAIL_H__
+#define __LOGACCESS_TAIL_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <string>
+
+namespace logaccess {
+
+// the most a single tail will return for one file
+static const boost::uint64_t kMaxTailBytes = 4 * 1024 * 1024;
+
+struct TailResult {
+    TailResult() : offset(0), size(0) {}
+    // where data starts in the file
+    boost::uint64_t offset;
+    // size of the file when it was read
+    boost::uint64_t size;
+    std::string data;
+};
+
+// the last lines lines (0 for no line limit) and at most bytes bytes
+// (0 for no byte limit, never more than kMaxTailBytes) of the file at
+// path.  line boundaries are found by reading backwards from the end,
+// so the cost is proportional to the output rather than the file.
+std::string tail(const boost::filesystem::path& path, boost::uint64_t lines,
+                 boost::uint64_t bytes, TailResult& result);
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_timeline.h"
+#include "logaccess_file.h"
+#include "logaccess_line.h"
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using logaccess::Timeline;
+using logaccess::TimelineLine;
+
+const std::size_t Timeline::kMaxLine;
+const boost::int64_t Timeline::kNoTime = std::numeric_limits<boost::int64_t>::min();
+
+// how much of each file is read at a time
+static const std::size_t kBufferSize = 64 * 1024;
+
+// One file of the merge and the line it has ready
+class Timeline::Source : boost::noncopyable {
+public:
+    Source() : m_pos(0), m_begin(0), m_end(0), m_eof(false), m_error(false), m_skipping(false),
+               m_lastTime(kNoTime), m_buf(kBufferSize) {}
+
+    bool open(const boost::filesystem::path& path, boost::uint64_t offset) {
+        m_path = path;
+        m_pos = offset;
+        return m_file.open(path);
+    }
+
+    const boost::filesystem::path& path() const { return m_path; }
+
+    // read the next line into line, false at end of file or on error
+    // (see error())
+    bool advance() {
+        for (;;) {
+            char* p = &m_buf[0];
+            char* nl = (char*) memchr(p + m_begin, '\n', m_end - m_begin);
+            if (!nl && m_end - m_begin < m_buf.size() && !m_eof) {
+                if (!fill()) {
+                    return false;
+                }
+                continue;
+            }
+            if (m_begin == m_end) {
+                return false;
+            }
+            // a whole line, the last one of the file, or a full buffer
+            // of an enormous one
+            std::size_t lineEnd = nl ? (nl - p) + 1 : m_end;
+            boost::uint64_t offset = m_pos - (m_end - m_begin);
+            bool skip = m_skipping;
+            m_skipping = !nl;
+            const char* start = p + m_begin;
+            m_begin = lineEnd;
+            if (skip) {
+                continue;
+            }
+            std::size_t len = lineEnd - (start - p);
+            while (len > 0 && (start[len - 1] == '\n' || start[len - 1] == '\r')) {
+                len--;
+            }
+            boost::int64_t t;
+            if (parseTimestamp(start, start + len, t)) {
+                m_lastTime = t;
+            }
+            line.offset = offset;
+            line.time = m_lastTime;
+            line.text.assign(start, std::min(len, kMaxLine));
+            return true;
+        }
+    }
+
+    bool error() const { return m_error; }
+
+    TimelineLine line;
+
+private:
+    // move what's left to the front of the buffer and read more after it
+    bool fill() {
+        m_error = false;
+        std::size_t left = m_end - m_begin;
+        memmove(&m_buf[0], &m_buf[m_begin], left);
+        m_begin = 0;
+        m_end = left;
+        long long n = m_file.readAt(m_pos, &m_buf[m_end], m_buf.size() - m_end);
+        if (n < 0) {
+            m_error = true;
+            return false;
+        }
+        if (n == 0) {
+            m_eof = true;
+        }
+        m_pos += n;
+        m_end += (std::size_t) n;
+        return true;
+    }
+
+    boost::filesystem::path m_path;
+    File m_file;
+    // file offset of m_buf[m_end]
+    boost::uint64_t m_pos;
+    std::size_t m_begin;
+    std::size_t m_end;
+    bool m_eof;
+    bool m_error;
+    // the rest of a cut line is still to come
+    bool m_skipping;
+    boost::int64_t m_lastTime;
+    std::vector<char> m_buf;
+};
+
+Timeline::Timeline() {
+}
+
+Timeline::~Timeline() {
+    for (std::vector<Source*>::const_iterator it = m_sources.begin(); it != m_sources.end(); ++it) {
+        delete *it;
+    }
+}
+
+bool
+Timeline::later(unsigned int a, unsigned int b) const {
+    boost::int64_t ta = m_sources[a]->line.time;
+    boost::int64_t tb = m_sources[b]->line.time;
+    return ta != tb ? ta > tb : a > b;
+}
+
+bool
+Timeline::add(const boost::filesystem::path& file, boost::uint64_t offset) {
+    Source* s = new Source;
+    if (!s->open(file, offset)) {
+        delete s;
+        return false;
+    }
+    unsigned int i = m_sources.size();
+    m_sources.push_back(s);
+    s->line.file = i;
+    if (s->advance()) {
+        m_heap.push_back(i);
+        std::push_heap(m_heap.begin(), m_heap.end(), boost::bind(&Timeline::later, this, _1, _2));
+    } else if (s->error()) {
+        m_failed = file;
+    }
+    return true;
+}
+
+bool
+Timeline::next(TimelineLine& line) {
+    if (m_heap.empty() || !m_failed.empty()) {
+        return false;
+    }
+    std::pop_heap(m_heap.begin(), m_heap.end(), boost::bind(&Timeline::later, this, _1, _2));
+    unsigned int i = m_heap.back();
+    Source* s = m_sources[i];
+    line.file = i;
+    line.offset = s->line.offset;
+    line.time = s->line.time;
+    line.text.swap(s->line.text);
+    if (s->advance()) {
+        std::push_heap(m_heap.begin(), m_heap.end(), boost::bind(&Timeline::later, this, _1, _2));
+    } else {
+        m_heap.pop_back();
+        if (s->error()) {
+            m_failed = s->path();
+        }
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_TIMELINE_H__
+#define __LOGACCESS_TIMELINE_H__
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+struct TimelineLine {
+    // index of the file among those added to the Timeline
+    unsigned int file;
+    boost::uint64_t offset;
+    // milliseconds, lines without a timestamp take the time of the line
+    // before them (kNoTime if there is none)
+    boost::int64_t time;
+    // without its line ending, cut at Timeline::kMaxLine bytes
+    std::string text;
+};
+
+// Merges any number of logfiles into a single sequence of lines ordered
+// by time.  Each file is read forward through a buffer of its own, so
+// memory grows with the number of files rather than their size, and
+// the first line is available as soon as each file's first buffer has
+// been read.
+class Timeline : boost::noncopyable {
+public:
+    // longer lines are cut, the rest of them is skipped
+    static const std::size_t kMaxLine = 16 * 1024;
+    // time of lines before a file's first timestamp
+    static const boost::int64_t kNoTime;
+
+    Timeline();
+    ~Timeline();
+
+    // merge file in, read from offset (which should be a line start).
+    // lines logged at the same time come from files added earlier first,
+    // so rotated copies of a log are best added before the log itself.
+    bool add(const boost::filesystem::path& file, boost::uint64_t offset);
+
+    // the next line, false once every file is exhausted or a read
+    // failed (see failed())
+    bool next(TimelineLine& line);
+
+    // the file a read failed on, or empty
+    const boost::filesystem::path& failed() const { return m_failed; }
+
+private:
+    class Source;
+
+    // heap order, the source with the earliest line on top
+    bool later(unsigned int a, unsigned int b) const;
+
+    std::vector<Source*> m_sources;
+    // indexes of sources with a line ready
+    std::vector<unsigned int> m_heap;
+    boost::filesystem::path m_failed;
+};
+
+}
+
+#endif
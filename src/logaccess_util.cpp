@@ -20,12 +20,16 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include "logaccess_util.h"
+#include "logaccess_dir.h"
+#include "logaccess_file.h"
+#include "logaccess_search.h"
 #include "bp-file/bpfile.h"
 #include "bpservice/bpserviceversion.h"
 //#include "bpserviceapi/bpcfunctions.h"
 #include "bpservice/bpservice.h"
-#include "bpservice/bpcallback.h"
-#include <list>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
 
 #ifdef WINDOWS
 #include <atlpath.h>
@@ -39,6 +43,10 @@
 #elif defined(MACOSX)
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreServices/CoreServices.h>
+#else
+#include <pwd.h>
+#include <stdlib.h>
+#include <unistd.h>
 #endif
 
 #ifdef MACOSX
@@ -100,32 +108,276 @@ getCSIDL(boost::filesystem::path& path, int csidl) {
 }
 #endif
 
-// get a list paths pointing at current logfiles
+// Discovery of the current log directory.  Both the platform and services
+// lay their logs out as <version>/[<installId>/]<name>.log, so rather than
+// walking everything below the version dirs we visit the version dirs
+// newest first, descend at most kMaxScanDepth levels, and only stat the
+// files whose names we care about.
+
+// how deep below a version dir logfiles may live
+static const unsigned int kMaxScanDepth = 1;
+
+// what a file found during the scan is worth, lower is better.  0 is
+// reserved for "not interesting".
+enum {
+    kRankNone = 0,
+    kRankLog = 1,
+    kRankConfig = 2,
+    kRankAnyFile = 3,
+    kNumRanks = 4
+};
+
+typedef int (*RankFunc)(const boost::filesystem::path& name);
+
+static int
+platformRank(const boost::filesystem::path& name) {
+    if (name == "BrowserPlusCore.log") {
+        return kRankLog;
+    } else if (name == "BrowserPlus.config") {
+        return kRankConfig;
+    }
+    // any file will do in case platform was never run.  we'll only hit
+    // this in build machine scenarios.
+    return kRankAnyFile;
+}
+
+static int
+serviceRank(const boost::filesystem::path& name) {
+    return name.extension().string() == ".log" ? kRankLog : kRankNone;
+}
+
+namespace {
+    struct VersionDir {
+        bplus::service::Version version;
+        boost::filesystem::path dir;
+    };
+
+    // newest first
+    bool newerVersion(const VersionDir& a, const VersionDir& b) {
+        return a.version.compare(b.version) > 0;
+    }
+
+    struct Best {
+        Best() : found(false), haveTime(false), mtime(0) {}
+        bool found;
+        bool haveTime;
+        std::time_t mtime;
+        boost::filesystem::path dir;
+    };
+}
+
+// collect the children of dir whose names are well formed versions
+// (major versions only if majorOnly), sorted newest first
+static bool
+findVersionDirs(const boost::filesystem::path& dir, bool majorOnly,
+                std::vector<VersionDir>& versionDirs,
+                std::vector<boost::filesystem::path>& visited) {
+    logaccess::DirReader reader(dir);
+    if (!reader.ok()) {
+        return false;
+    }
+    logaccess::DirEntry entry;
+    while (reader.next(entry)) {
+        if (entry.type != logaccess::DirEntry::Dir && entry.type != logaccess::DirEntry::Unknown) {
+            continue;
+        }
+        VersionDir vd;
+        if (!vd.version.parse(entry.name.string())) {
+            continue;
+        }
+        if (majorOnly && (vd.version.majorVer() == -1 || vd.version.minorVer() != -1
+                          || vd.version.microVer() != -1)) {
+            continue;
+        }
+        if (entry.type == logaccess::DirEntry::Unknown) {
+            logaccess::FileInfo info;
+            if (!reader.stat(entry, info) || !info.isDir) {
+                continue;
+            }
+        }
+        vd.dir = dir / entry.name;
+        versionDirs.push_back(vd);
+        visited.push_back(vd.dir);
+    }
+    if (reader.failed()) {
+        return false;
+    }
+    std::sort(versionDirs.begin(), versionDirs.end(), newerVersion);
+    return true;
+}
+
+// scan dir (and its subdirs down to kMaxScanDepth) keeping the newest
+// file of each rank
+static bool
+scanDir(const boost::filesystem::path& dir, unsigned int depth, RankFunc rank,
+        Best best[kNumRanks], std::vector<boost::filesystem::path>& visited) {
+    logaccess::DirReader reader(dir);
+    if (!reader.ok()) {
+        return false;
+    }
+    std::vector<boost::filesystem::path> subdirs;
+    logaccess::DirEntry entry;
+    while (reader.next(entry)) {
+        logaccess::FileInfo info;
+        bool haveInfo = false;
+        if (entry.type == logaccess::DirEntry::Unknown) {
+            if (!reader.stat(entry, info)) {
+                continue;
+            }
+            haveInfo = true;
+            entry.type = info.isDir ? logaccess::DirEntry::Dir
+                       : info.isFile ? logaccess::DirEntry::File : logaccess::DirEntry::Other;
+        }
+        if (entry.type == logaccess::DirEntry::Dir) {
+            if (depth < kMaxScanDepth) {
+                subdirs.push_back(dir / entry.name);
+            }
+            continue;
+        }
+        if (entry.type != logaccess::DirEntry::File) {
+            continue;
+        }
+        int r = rank(entry.name);
+        if (r == kRankNone) {
+            continue;
+        }
+        Best& b = best[r];
+        if (r == kRankAnyFile) {
+            // first one will do, no need to know when it was written
+            if (!b.found) {
+                b.found = true;
+                b.dir = dir;
+            }
+            continue;
+        }
+        if (!haveInfo) {
+            haveInfo = reader.stat(entry, info);
+        }
+        if (!haveInfo) {
+            // error reading timestamp of this file!  if nothing else of
+            // this rank has been found, we'll assume this is our guy.
+            if (!b.found) {
+                b.found = true;
+                b.dir = dir;
+            }
+            continue;
+        }
+        if (!b.found || !b.haveTime || info.mtime > b.mtime) {
+            b.found = true;
+            b.haveTime = true;
+            b.mtime = info.mtime;
+            b.dir = dir;
+        }
+    }
+    if (reader.failed()) {
+        return false;
+    }
+    for (std::vector<boost::filesystem::path>::const_iterator it = subdirs.begin(); it != subdirs.end(); ++it) {
+        visited.push_back(*it);
+        if (!scanDir(*it, depth + 1, rank, best, visited)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// search version dirs (newest first) for the directory holding the
+// newest best ranked file.  with firstWins it stops at the first version
+// dir holding a logfile, as older versions can't hold the current logs.
+// otherwise the newest logfile of any version wins.  logDir is left
+// empty if nothing was found.
+static bool
+findNewest(const std::vector<VersionDir>& versionDirs, RankFunc rank, bool firstWins,
+           boost::filesystem::path& logDir,
+           std::vector<boost::filesystem::path>& visited) {
+    Best newest;
+    Best fallback[kNumRanks];
+    for (std::vector<VersionDir>::const_iterator it = versionDirs.begin(); it != versionDirs.end(); ++it) {
+        Best best[kNumRanks];
+        if (!scanDir(it->dir, 0, rank, best, visited)) {
+            return false;
+        }
+        const Best& log = best[kRankLog];
+        if (log.found) {
+            if (firstWins) {
+                logDir = log.dir;
+                return true;
+            }
+            // on a tie (or no times) the newer version keeps it
+            if (!newest.found || (log.haveTime && (!newest.haveTime || log.mtime > newest.mtime))) {
+                newest = log;
+            }
+            continue;
+        }
+        // a newer version's backup beats an older one's
+        for (int r = kRankLog + 1; r < kNumRanks; r++) {
+            if (!fallback[r].found && best[r].found) {
+                fallback[r] = best[r];
+            }
+        }
+    }
+    if (newest.found) {
+        logDir = newest.dir;
+        return true;
+    }
+    for (int r = kRankLog + 1; r < kNumRanks; r++) {
+        if (fallback[r].found) {
+            logDir = fallback[r].dir;
+            break;
+        }
+    }
+    return true;
+}
+
+#if !defined(WINDOWS) && !defined(MACOSX)
+// the user's XDG data dir, $XDG_DATA_HOME or ~/.local/share
+static bool
+xdgDataHome(boost::filesystem::path& path) {
+    const char* dataHome = getenv("XDG_DATA_HOME");
+    // the spec says relative paths are to be ignored
+    if (dataHome && dataHome[0] == '/') {
+        path = dataHome;
+        return true;
+    }
+    const char* home = getenv("HOME");
+    if (!home || !home[0]) {
+        struct passwd* pw = getpwuid(getuid());
+        home = pw ? pw->pw_dir : NULL;
+    }
+    if (!home || !home[0]) {
+        return false;
+    }
+    path = boost::filesystem::path(home) / ".local" / "share";
+    return true;
+}
+#endif
+
 std::string
-logaccess::util::getLogfilePaths(bplus::List& paths) {
+logaccess::util::getRoots(Roots& roots) {
     // first we have to determine the path to logfiles, this is complicated
     // because different platforms have different restrictions where different
     // code running in different contexts can write files.  (namely activex
     // controls running under win7 and vista must write under a "LocalLow"
-    // directory).  Further complexity comes from a couple factors:
-    // 1. we're duplicating logic typically in the platform inside a service
-    // 2. we don't know what the latest version of the platform that's installed
-    //    is.
-    // all that said, let's get to it
-    // a. first let's find the user scoped "plugin writable" path.
+    // directory).  Further complexity comes from the fact that we're
+    // duplicating logic typically in the platform inside a service.
+    // a. the user scoped "plugin writable" path holds the platform's logs,
+    //    the application data path the services' data.
     boost::filesystem::path pluginWriteDir;
+    boost::filesystem::path coreletDataDir;
 #ifdef WINDOWS
     bool isVistaOrLater = (PlatformVersion().compare("6") >= 0);
     if (isVistaOrLater) {
-        if (!getCSIDL(pluginWriteDir, CSIDL_LOCAL_APPDATA)) {
+        if (!getCSIDL(coreletDataDir, CSIDL_LOCAL_APPDATA)) {
             return std::string("couldn't determine windows AppData directory");
         }
+        pluginWriteDir = coreletDataDir;
         pluginWriteDir.remove_filename();
         pluginWriteDir /= L"LocalLow";
     } else {
-        if (!getCSIDL(pluginWriteDir, CSIDL_LOCAL_APPDATA)) {
+        if (!getCSIDL(coreletDataDir, CSIDL_LOCAL_APPDATA)) {
             return std::string("couldn't determine winxp AppData directory");
         }
+        pluginWriteDir = coreletDataDir;
     }
 #elif defined(MACOSX)
     // Get application support dir
@@ -140,220 +392,321 @@ logaccess::util::getLogfilePaths(bplus::List& paths) {
     } else {
         return std::string("couldn't find user scoped application support directory");        
     }
+    coreletDataDir = pluginWriteDir;
 #else
-#error "platforms not yet supported"
+    // linux and other unixes keep application data where the XDG base
+    // directory spec says to
+    if (!xdgDataHome(pluginWriteDir)) {
+        return std::string("couldn't determine XDG data directory");
+    }
+    coreletDataDir = pluginWriteDir;
 #endif
     if (pluginWriteDir.empty()) {
         return std::string("couldn't determine plugin writable directory");
     }
+    if (coreletDataDir.empty()) {
+        return std::string("couldn't determine application support directory");
+    }
     // append Yahoo!/BrowserPlus
-    pluginWriteDir /= boost::filesystem::path("Yahoo!")/boost::filesystem::path("BrowserPlus");
+    boost::filesystem::path bpDir = boost::filesystem::path("Yahoo!") / boost::filesystem::path("BrowserPlus");
+    roots.platformDir = pluginWriteDir / bpDir;
+    roots.serviceDataDir = coreletDataDir / bpDir / "CoreletData";
+    return std::string();
+}
+
+std::string
+logaccess::util::findLogDir(const Roots& roots, boost::filesystem::path& logDir,
+                            std::vector<boost::filesystem::path>& visited) {
+    const boost::filesystem::path& pluginWriteDir = roots.platformDir;
     if (!bp::file::isDirectory(pluginWriteDir)) {
         return std::string("logfile directory does not exist!");
     }
+    visited.push_back(pluginWriteDir);
     // b. now we must figure out the latest version of the platform that is installed.
-    //    first we'll do a non-recursive iteration to find the dirs that exist that are
-    //    well formed versions, and we'll follow up with a pass to find BrowserPlusCore.log
-    //    inside those directories.  In case there's multiple such log files, the parent
-    //    of the newest created logfile wins.  If BrowserPlusCore.log does not exist (like
-    //    perhaps this service is first to run since BrowserPlus has been installed/reinstalled)
-    //    we'll use the directory of the newest created BrowserPlus.config file.
-    std::list<boost::filesystem::path> versionDirs;
-    try {
-        boost::filesystem::directory_iterator end;
-        for (boost::filesystem::directory_iterator it(pluginWriteDir); it != end; ++it) {
-            bplus::service::Version v;
-            if (v.parse(it->path().filename().string())) {
-                versionDirs.push_back(it->path());
-            }
-        }
-    } catch (const boost::filesystem::filesystem_error&) {
+    //    the platform always runs the newest installed version, so version dirs are
+    //    searched newest first and the first one holding a BrowserPlusCore.log wins.
+    //    within that version, the installation id dir with the newest logfile wins.
+    //    If BrowserPlusCore.log does not exist anywhere (like perhaps this service is
+    //    first to run since BrowserPlus has been installed/reinstalled) we'll use the
+    //    directory of the newest BrowserPlus.config file.
+    std::vector<VersionDir> versionDirs;
+    if (!findVersionDirs(pluginWriteDir, false, versionDirs, visited)) {
         return std::string("unable to iterate thru plugin writable dir");
     }
     // c. now that we've got the platform directories, we have to find the appropriate
     //    child path to the installation id directory where logfiles are stored
-    boost::filesystem::path logDir;
-    boost::filesystem::path logDir_backup;
-    std::time_t lastWrite = 0;
-    for (std::list<boost::filesystem::path>::const_iterator it = versionDirs.begin(); it != versionDirs.end(); it++) {
-        try {
-            boost::filesystem::recursive_directory_iterator end;
-            for (boost::filesystem::recursive_directory_iterator rdit(*it); rdit != end; ++rdit) {
-                // save off the first path, in case platform was never run.
-                // we'll only hit this in build machine scenarios.
-                if (logDir_backup.empty()) {
-                    logDir_backup = rdit->path();
-                    logDir_backup.remove_filename();
-                }
-                if (rdit->path().filename() == "BrowserPlusCore.log") {
-                    try {
-                        std::time_t curWrite = boost::filesystem::last_write_time(*rdit);
-                        if (curWrite > lastWrite) {
-                            curWrite = lastWrite;
-                            logDir = rdit->path();
-                            logDir.remove_filename();
-                        }
-                    } catch (const boost::filesystem::filesystem_error& /*e*/) {
-                        // error reading timestamp of this file!  if no other
-                        // BrowserPlusCore.log files have been found, we'll
-                        // assume this is our guy.
-                        if (logDir.empty()) {
-                            logDir = rdit->path();                        
-                            logDir.remove_filename();
-                        }
-                    }
-                }
-                else if (rdit->path().filename() == "BrowserPlus.config") {
-                    try {
-                        std::time_t curWrite = boost::filesystem::last_write_time(*rdit);
-                        if (curWrite > lastWrite) {
-                            curWrite = lastWrite;
-                            logDir_backup = rdit->path();
-                            logDir_backup.remove_filename();
-                        }
-                    } catch (const boost::filesystem::filesystem_error& /*e*/) {
-                        // error reading timestamp of this file!  if no other
-                        // BrowserPlus.config files have been found, we'll
-                        // assume this is our guy.
-                        if (logDir_backup.empty()) {
-                            logDir_backup = rdit->path();                        
-                            logDir_backup.remove_filename();
-                        }
-                    }
-                }
-            }
-        } catch (const boost::filesystem::filesystem_error& /*e*/) {
-            return std::string("unable to iterate thru platform version dir");
-        }
-    }
-    if (logDir.empty() && !logDir_backup.empty()) {
-        logDir = logDir_backup;
+    if (!findNewest(versionDirs, platformRank, true, logDir, visited)) {
+        return std::string("unable to iterate thru platform version dir");
     }
     if (logDir.empty()) {
         return std::string("unable to find current log directory");        
     }
-    // d. now we've got what we're reasonably sure is the current logfile directory, lets'
-    //    add all .log files to the output parameter
-    try {
-        boost::filesystem::directory_iterator end;
-        for (boost::filesystem::directory_iterator it(logDir); it != end; ++it) {
-            if (bp::file::isRegularFile(it->path())) {
-                if (it->path().extension().string() == ".log") {
-                    paths.append(new bplus::Path(bp::file::nativeString(it->path())));
-                }
-            }
-        }
-    } catch (const boost::filesystem::filesystem_error& /*e*/) {
-        return std::string("unable to iterate thru plugin writable dir");
+    // success!
+    return std::string();
+}
+
+std::string
+logaccess::util::findLogDir(boost::filesystem::path& logDir,
+                            std::vector<boost::filesystem::path>& visited) {
+    Roots roots;
+    std::string error = getRoots(roots);
+    if (!error.empty()) {
+        return error;
+    }
+    return findLogDir(roots, logDir, visited);
+}
+
+std::string
+logaccess::util::findServiceLogDir(const Roots& roots, const std::string& service,
+                                   boost::filesystem::path& logDir,
+                                   std::vector<boost::filesystem::path>& visited) {
+    // <serviceDataDir>/<service>
+    boost::filesystem::path coreletDataDir = roots.serviceDataDir / service;
+    if (!bp::file::isDirectory(coreletDataDir)) {
+        return std::string("");
+    }
+    visited.push_back(coreletDataDir);
+    // Now find the most recently written log file.  unlike the platform an
+    // older major version of a service may still be the one in use (pages
+    // can ask for it), so every major version dir is searched and the parent
+    // of the newest *.log in any of them wins
+    std::vector<VersionDir> versionDirs;
+    if (!findVersionDirs(coreletDataDir, true, versionDirs, visited)) {
+        return std::string("unable to iterate thru CoreletData dir for service ") + service;
+    }
+    if (!findNewest(versionDirs, serviceRank, false, logDir, visited)) {
+        return std::string("unable to iterate thru service version dir");
+    }
+    if (logDir.empty()) {
+        return std::string("unable to find current log directory");        
     }
     // success!
     return std::string();
 }
 
 std::string
-logaccess::util::getServiceLogfilePaths(const std::string& service, bplus::List& paths) {
-    boost::filesystem::path coreletDataDir;
-#ifdef WINDOWS
-    bool isVistaOrLater = (PlatformVersion().compare("6") >= 0);
-    if (isVistaOrLater) {
-        if (!getCSIDL(coreletDataDir, CSIDL_LOCAL_APPDATA)) {
-            return std::string("couldn't determine windows AppData directory");
-        }
-    } else {
-        if (!getCSIDL(coreletDataDir, CSIDL_LOCAL_APPDATA)) {
-            return std::string("couldn't determine winxp AppData directory");
+logaccess::util::findServiceLogDir(const std::string& service,
+                                   boost::filesystem::path& logDir,
+                                   std::vector<boost::filesystem::path>& visited) {
+    Roots roots;
+    std::string error = getRoots(roots);
+    if (!error.empty()) {
+        return error;
+    }
+    return findServiceLogDir(roots, service, logDir, visited);
+}
+
+// bytes of a logfile examined to estimate its line count, half from
+// each end.  smaller files are counted exactly.
+static const std::size_t kLineSample = 64 * 1024;
+
+static boost::uint64_t
+estimateLines(const boost::filesystem::path& path, boost::uint64_t size) {
+    logaccess::File file;
+    if (size == 0 || !file.open(path)) {
+        return 0;
+    }
+    std::string head, tail;
+    if (size <= kLineSample) {
+        if (!file.read(0, (std::size_t) size, head)) {
+            return 0;
         }
+    } else if (!file.read(0, kLineSample / 2, head)
+               || !file.read(size - kLineSample / 2, kLineSample / 2, tail)) {
+        return 0;
     }
-#elif defined(MACOSX)
-    // Get application support dir
-    FSRef fref;
-    OSErr err = FSFindFolder(kUserDomain, kApplicationSupportFolderType, kCreateFolder, &fref);
-    if (err == noErr) {
-        CFURLRef tmpUrl = CFURLCreateFromFSRef(kCFAllocatorSystemDefault, &fref);
-        CFStringRef ctmpDir = CFURLCopyFileSystemPath(tmpUrl, kCFURLPOSIXPathStyle);
-        coreletDataDir = stringRefToUTF8(ctmpDir);
-        CFRelease(ctmpDir);
-        CFRelease(tmpUrl);
-    } else {
-        return std::string("couldn't find user scoped application support directory");        
+    std::size_t sampled = head.size() + tail.size();
+    boost::uint64_t newlines = logaccess::countNewlines(head.data(), head.size())
+        + logaccess::countNewlines(tail.data(), tail.size());
+    if (sampled == 0 || sampled >= size) {
+        return newlines;
     }
-#else
-#error "platforms not yet supported"
-#endif
-    if (coreletDataDir.empty()) {
-        return std::string("couldn't determine application support directory");
+    return (boost::uint64_t) ((double) newlines * size / sampled + 0.5);
+}
+
+// a .log file in entry, stat'ed into info if details are wanted
+static bool
+isLogFile(logaccess::DirReader& reader, const logaccess::DirEntry& entry,
+          bool details, logaccess::FileInfo& info) {
+    if (entry.name.extension().string() != ".log") {
+        return false;
     }
-    // append Yahoo!/BrowserPlus/CoreletData/<service>
-    coreletDataDir /= boost::filesystem::path("Yahoo!/BrowserPlus/CoreletData") / service;
-    if (!bp::file::isDirectory(coreletDataDir)) {
-        return std::string("");
+    if (entry.haveInfo) {
+        info = entry.info;
+        return info.isFile;
     }
-    // Now find the latest major version with a log file.
-    //    first we'll do a non-recursive iteration to find the dirs that exist that are
-    //    well formed major versions, and we'll follow up with a pass to find *.log
-    //    inside those directories.  In case there's multiple such log files, the parent
-    //    of the newest created logfile wins
-    std::list<boost::filesystem::path> versionDirs;
-    try {
-        boost::filesystem::directory_iterator end;
-        for (boost::filesystem::directory_iterator it(coreletDataDir); it != end; ++it) {
-            bplus::service::Version v;
-            if (v.parse(it->path().filename().string()) && v.majorVer() != -1 && v.minorVer() == -1 && v.microVer() == -1) {
-                versionDirs.push_back(it->path());
-            }
+    if (entry.type == logaccess::DirEntry::File && !details) {
+        return true;
+    }
+    if (entry.type != logaccess::DirEntry::File && entry.type != logaccess::DirEntry::Unknown) {
+        return false;
+    }
+    return reader.stat(entry, info) && info.isFile;
+}
+
+// append the .log files in logDir to out, as paths or, given a
+// component, as maps of their details
+static std::string
+appendLogFiles(const boost::filesystem::path& logDir, const std::string* component,
+               bplus::List& out) {
+    // now we've got what we're reasonably sure is the current logfile directory, lets'
+    // add all .log files to the output parameter
+    logaccess::DirReader reader(logDir);
+    if (!reader.ok()) {
+        return std::string("unable to iterate thru log directory");
+    }
+    logaccess::DirEntry entry;
+    while (reader.next(entry)) {
+        logaccess::FileInfo info;
+        if (!isLogFile(reader, entry, component != NULL, info)) {
+            continue;
         }
-    } catch (const boost::filesystem::filesystem_error& /*e*/) {
-        return std::string("unable to iterate thru CoreletData dir for service ") + service;
+        boost::filesystem::path path = logDir / entry.name;
+        bplus::Path* p = new bplus::Path(bp::file::nativeString(path));
+        if (!component) {
+            out.append(p);
+            continue;
+        }
+        bplus::Map* m = new bplus::Map;
+        m->add("path", p);
+        m->add("size", new bplus::Integer(info.size));
+        m->add("modified", new bplus::Integer((long long) info.mtime * 1000));
+        m->add("lines", new bplus::Integer(estimateLines(path, info.size)));
+        m->add("component", new bplus::String(*component));
+        out.append(m);
     }
-    // c. now that we've got the version directories, find the one with the most recent
-    //    log file
-    boost::filesystem::path logDir;
-    std::time_t lastWrite = 0;
-    for (std::list<boost::filesystem::path>::const_iterator it = versionDirs.begin(); it != versionDirs.end(); it++) {
-        try {
-            boost::filesystem::recursive_directory_iterator end;
-            for (boost::filesystem::recursive_directory_iterator rdit(*it); rdit != end; ++rdit) {
-                if (rdit->path().extension().string() == ".log") {
-                    try {
-                        std::time_t curWrite = boost::filesystem::last_write_time(*rdit);
-                        if (curWrite > lastWrite) {
-                            curWrite = lastWrite;
-                            logDir = rdit->path();
-                            logDir.remove_filename();
-                        }
-                    } catch (const boost::filesystem::filesystem_error& /*e*/) {
-                        // error reading timestamp of this file!  if no other
-                        // .log files have been found, we'll
-                        // assume this is our guy.
-                        if (logDir.empty()) {
-                            logDir = rdit->path();                        
-                            logDir.remove_filename();
-                        }
-                    }
-                }
-            }
-        } catch (const boost::filesystem::filesystem_error& /*e*/) {
-            return std::string("unable to iterate thru service version dir");
+    if (reader.failed()) {
+        return std::string("unable to iterate thru log directory");
+    }
+    // success!
+    return std::string();
+}
+
+std::string
+logaccess::util::listLogFiles(const boost::filesystem::path& logDir, bplus::List& paths) {
+    return appendLogFiles(logDir, NULL, paths);
+}
+
+std::string
+logaccess::util::listLogFiles(const boost::filesystem::path& logDir,
+                              const std::string& component, bplus::List& files) {
+    return appendLogFiles(logDir, &component, files);
+}
+
+// the first element of path below base, empty if path isn't below it
+static std::string
+firstElementBelow(const boost::filesystem::path& base, const boost::filesystem::path& path) {
+    boost::filesystem::path::const_iterator b = base.begin(), p = path.begin();
+    for (; b != base.end(); ++b, ++p) {
+        if (p == path.end() || *p != *b) {
+            return std::string();
         }
     }
-    if (logDir.empty()) {
-        return std::string("unable to find current log directory");        
+    return p == path.end() ? std::string() : p->string();
+}
+
+std::string
+logaccess::util::logComponent(const Roots& roots, const std::string& service,
+                              const boost::filesystem::path& logDir) {
+    std::string version;
+    if (service.empty()) {
+        version = firstElementBelow(roots.platformDir, logDir);
+        return version.empty() ? std::string("platform") : "platform/" + version;
+    }
+    version = firstElementBelow(roots.serviceDataDir / service, logDir);
+    return version.empty() ? service : service + "/" + version;
+}
+
+namespace {
+    struct Rotated {
+        unsigned long number;
+        boost::filesystem::path name;
+    };
+
+    bool olderRotation(const Rotated& a, const Rotated& b) {
+        return a.number > b.number;
+    }
+}
+
+std::string
+logaccess::util::listRotated(const boost::filesystem::path& logfile,
+                             std::vector<boost::filesystem::path>& rotated) {
+    boost::filesystem::path dir = logfile.parent_path();
+    std::string prefix = logfile.filename().string() + ".";
+    logaccess::DirReader reader(dir);
+    if (!reader.ok()) {
+        return std::string("unable to iterate thru log directory");
     }
-    // d. now we've got what we're reasonably sure is the current logfile directory, lets'
-    //    add all .log files to the output parameter
-    try {
-        boost::filesystem::directory_iterator end;
-        for (boost::filesystem::directory_iterator it(logDir); it != end; ++it) {
-            if (bp::file::isRegularFile(it->path())) {
-                if (it->path().extension().string() == ".log") {
-                    paths.append(new bplus::Path(bp::file::nativeString(it->path())));
-                }
+    std::vector<Rotated> found;
+    logaccess::DirEntry entry;
+    while (reader.next(entry)) {
+        std::string name = entry.name.string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0
+            || name.find_first_not_of("0123456789", prefix.size()) != std::string::npos) {
+            continue;
+        }
+        if (entry.type != logaccess::DirEntry::File) {
+            logaccess::FileInfo info;
+            if (entry.type != logaccess::DirEntry::Unknown
+                || !reader.stat(entry, info) || !info.isFile) {
+                continue;
             }
         }
-    } catch (const boost::filesystem::filesystem_error& /*e*/) {
-        return std::string("unable to iterate thru service data dir");
+        Rotated r;
+        r.number = strtoul(name.c_str() + prefix.size(), NULL, 10);
+        r.name = entry.name;
+        found.push_back(r);
+    }
+    if (reader.failed()) {
+        return std::string("unable to iterate thru log directory");
+    }
+    std::sort(found.begin(), found.end(), olderRotation);
+    for (std::vector<Rotated>::const_iterator it = found.begin(); it != found.end(); ++it) {
+        rotated.push_back(dir / it->name);
     }
-    // success!
     return std::string();
 }
 
+// get a list paths pointing at current logfiles
+std::string
+logaccess::util::getLogfilePaths(const Roots& roots, bplus::List& paths) {
+    boost::filesystem::path logDir;
+    std::vector<boost::filesystem::path> visited;
+    std::string error = findLogDir(roots, logDir, visited);
+    if (!error.empty()) {
+        return error;
+    }
+    return listLogFiles(logDir, paths);
+}
+
+std::string
+logaccess::util::getLogfilePaths(bplus::List& paths) {
+    Roots roots;
+    std::string error = getRoots(roots);
+    if (!error.empty()) {
+        return error;
+    }
+    return getLogfilePaths(roots, paths);
+}
+
+std::string
+logaccess::util::getServiceLogfilePaths(const Roots& roots, const std::string& service,
+                                        bplus::List& paths) {
+    boost::filesystem::path logDir;
+    std::vector<boost::filesystem::path> visited;
+    std::string error = findServiceLogDir(roots, service, logDir, visited);
+    if (!error.empty() || logDir.empty()) {
+        return error;
+    }
+    return listLogFiles(logDir, paths);
+}
+
+std::string
+logaccess::util::getServiceLogfilePaths(const std::string& service, bplus::List& paths) {
+    Roots roots;
+    std::string error = getRoots(roots);
+    if (!error.empty()) {
+        return error;
+    }
+    return getServiceLogfilePaths(roots, service, paths);
+}
@@ -23,15 +23,72 @@
 #define __LOGACCESS_UTIL_H__
 
 #include "bputil/bptypeutil.h"
+#include <boost/filesystem.hpp>
+#include <vector>
 
 namespace logaccess {
 namespace util {
 
+// Where discovery starts.  The platform keeps its version dirs directly
+// below platformDir, a service keeps its data below
+// serviceDataDir/<service>.  Pointing these somewhere else (a generated
+// tree, say) makes everything below them discoverable the same way.
+struct Roots {
+    boost::filesystem::path platformDir;
+    boost::filesystem::path serviceDataDir;
+};
+
+// the roots of the current user on this platform.  windows and mac
+// use the usual application data folders, everything else follows the
+// XDG base directory spec ($XDG_DATA_HOME or ~/.local/share).
+std::string getRoots(Roots& roots);
+
 // get a list paths pointing at current logfiles
 std::string getLogfilePaths(bplus::List& paths);
+std::string getLogfilePaths(const Roots& roots, bplus::List& paths);
 
 // get a list paths pointing at current logfiles for a service
 std::string getServiceLogfilePaths(const std::string& service, bplus::List& paths);
+std::string getServiceLogfilePaths(const Roots& roots, const std::string& service,
+                                   bplus::List& paths);
+
+// find the directory holding the current platform logfiles.  every
+// directory examined along the way is appended to visited, a change
+// to any of them may change the answer.
+std::string findLogDir(boost::filesystem::path& logDir,
+                       std::vector<boost::filesystem::path>& visited);
+std::string findLogDir(const Roots& roots, boost::filesystem::path& logDir,
+                       std::vector<boost::filesystem::path>& visited);
+
+// find the directory holding the current logfiles for a service.
+// logDir is left empty (with no error) if the service has no data dir.
+std::string findServiceLogDir(const std::string& service,
+                              boost::filesystem::path& logDir,
+                              std::vector<boost::filesystem::path>& visited);
+std::string findServiceLogDir(const Roots& roots, const std::string& service,
+                              boost::filesystem::path& logDir,
+                              std::vector<boost::filesystem::path>& visited);
+
+// append all .log files in logDir to paths
+std::string listLogFiles(const boost::filesystem::path& logDir, bplus::List& paths);
+
+// append all .log files in logDir to files as maps holding the "path",
+// "size", "modified" time (milliseconds since 1970), approximate
+// number of "lines" and the "component" (see logComponent) of each.
+// all of it is gathered while listing the directory, the line count
+// is estimated from a sample of the file.
+std::string listLogFiles(const boost::filesystem::path& logDir,
+                         const std::string& component, bplus::List& files);
+
+// what writes the logs in logDir, found for service (the platform if
+// empty) below roots: "platform/<version>" or "<service>/<major version>"
+std::string logComponent(const Roots& roots, const std::string& service,
+                         const boost::filesystem::path& logDir);
+
+// append the rotated copies of logfile found next to it (<name>.1,
+// <name>.2 and so on) to rotated, oldest (highest numbered) first
+std::string listRotated(const boost::filesystem::path& logfile,
+                        std::vector<boost::filesystem::path>& rotated);
 
 }
 }
@@ -0,0 +1,405 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_watch.h"
+
+#include <map>
+#include <set>
+
+#ifdef LINUX
+#include <boost/thread/mutex.hpp>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(MACOSX)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/event.h>
+#include <unistd.h>
+#elif defined(WINDOWS)
+#include <windows.h>
+#else
+#include <boost/thread/thread.hpp>
+#endif
+
+using logaccess::DirWatcher;
+using logaccess::FileNotifier;
+
+// directory timestamps have coarse granularity, a stamp this close
+// to the current time might hide a change made later in the same tick.
+static const std::time_t kStampSlop = 2;
+
+#ifdef LINUX
+// every DirWatcher shares one inotify instance, a user gets only 128 of
+// them (max_user_instances) across all processes.  its events are handed
+// to the watchers of their watch descriptors.  it stays open for the life
+// of the process.
+static boost::mutex s_inotifyLock;
+static int s_inotifyFd = -1;
+static bool s_inotifyOpened = false;
+static std::map<int, std::set<DirWatcher*> > s_inotifyWatchers;
+
+// the shared instance, -1 if there's none.  call with s_inotifyLock held.
+static int
+sharedInotify() {
+    if (!s_inotifyOpened) {
+        s_inotifyOpened = true;
+        s_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+    return s_inotifyFd;
+}
+#endif
+
+DirWatcher::DirWatcher() : m_changed(false) {
+#ifdef LINUX
+    boost::mutex::scoped_lock lock(s_inotifyLock);
+    m_inotify = sharedInotify() >= 0;
+#endif
+}
+
+DirWatcher::~DirWatcher() {
+#ifdef LINUX
+    boost::mutex::scoped_lock lock(s_inotifyLock);
+    for (std::vector<int>::const_iterator it = m_wds.begin(); it != m_wds.end(); ++it) {
+        std::map<int, std::set<DirWatcher*> >::iterator w = s_inotifyWatchers.find(*it);
+        if (w == s_inotifyWatchers.end()) {
+            // the kernel dropped it already
+            continue;
+        }
+        w->second.erase(this);
+        if (w->second.empty()) {
+            inotify_rm_watch(s_inotifyFd, *it);
+            s_inotifyWatchers.erase(w);
+        }
+    }
+#endif
+}
+
+bool
+DirWatcher::add(const boost::filesystem::path& dir) {
+#ifdef LINUX
+    if (m_inotify) {
+        uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                      | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+        boost::mutex::scoped_lock lock(s_inotifyLock);
+        // a directory watched by several watchers has one descriptor
+        int wd = inotify_add_watch(s_inotifyFd, dir.string().c_str(), mask);
+        if (wd < 0) {
+            return false;
+        }
+        s_inotifyWatchers[wd].insert(this);
+        m_wds.push_back(wd);
+        return true;
+    }
+#endif
+    Stamp s;
+    s.dir = dir;
+    try {
+        s.mtime = boost::filesystem::last_write_time(dir);
+    } catch (const boost::filesystem::filesystem_error& /*e*/) {
+        return false;
+    }
+    if (s.mtime + kStampSlop >= std::time(NULL)) {
+        // too fresh to trust, force a recheck next time around
+        m_changed = true;
+    }
+    m_stamps.push_back(s);
+    return true;
+}
+
+#ifdef LINUX
+void
+DirWatcher::readEvents() {
+    // any event at all for a watcher means something it cares about
+    // moved.  a queue overflow or a broken instance means anything may
+    // have, so everyone is marked.
+    long buf[4096 / sizeof(long)];
+    for (;;) {
+        ssize_t n = read(s_inotifyFd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        bool all = n == 0 || (n < 0 && errno != EAGAIN);
+        for (const char* p = (const char*) buf; n > 0 && p < (const char*) buf + n; ) {
+            const struct inotify_event* ev = (const struct inotify_event*) p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                all = true;
+                continue;
+            }
+            std::map<int, std::set<DirWatcher*> >::iterator w = s_inotifyWatchers.find(ev->wd);
+            if (w == s_inotifyWatchers.end()) {
+                continue;
+            }
+            for (std::set<DirWatcher*>::const_iterator it = w->second.begin(); it != w->second.end(); ++it) {
+                (*it)->m_changed = true;
+            }
+            if (ev->mask & IN_IGNORED) {
+                // the directory is gone, and the kernel may reuse its wd
+                s_inotifyWatchers.erase(w);
+            }
+        }
+        if (all) {
+            std::map<int, std::set<DirWatcher*> >::iterator w;
+            for (w = s_inotifyWatchers.begin(); w != s_inotifyWatchers.end(); ++w) {
+                for (std::set<DirWatcher*>::const_iterator it = w->second.begin(); it != w->second.end(); ++it) {
+                    (*it)->m_changed = true;
+                }
+            }
+        }
+        if (n <= 0) {
+            break;
+        }
+    }
+}
+#endif
+
+bool
+DirWatcher::changed() {
+#ifdef LINUX
+    if (m_inotify) {
+        boost::mutex::scoped_lock lock(s_inotifyLock);
+        if (!m_changed) {
+            readEvents();
+        }
+        return m_changed;
+    }
+#endif
+    if (m_changed) {
+        return true;
+    }
+    for (std::vector<Stamp>::const_iterator it = m_stamps.begin(); it != m_stamps.end(); ++it) {
+        try {
+            if (boost::filesystem::last_write_time(it->dir) != it->mtime) {
+                m_changed = true;
+                break;
+            }
+        } catch (const boost::filesystem::filesystem_error& /*e*/) {
+            m_changed = true;
+            break;
+        }
+    }
+    return m_changed;
+}
+
+// the distinct parent directories of files
+static std::vector<boost::filesystem::path>
+parentDirs(const std::vector<boost::filesystem::path>& files) {
+    std::set<boost::filesystem::path> seen;
+    std::vector<boost::filesystem::path> dirs;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        if (seen.insert(it->parent_path()).second) {
+            dirs.push_back(it->parent_path());
+        }
+    }
+    return dirs;
+}
+
+#ifdef LINUX
+
+FileNotifier::FileNotifier() : m_fd(-1) {
+}
+
+void
+FileNotifier::clear() {
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool
+FileNotifier::watch(const std::vector<boost::filesystem::path>& files) {
+    // a fresh instance is the simplest way to drop every old watch
+    clear();
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+        ok = inotify_add_watch(m_fd, it->string().c_str(), mask) >= 0 && ok;
+    }
+    std::vector<boost::filesystem::path> dirs = parentDirs(files);
+    for (std::vector<boost::filesystem::path>::const_iterator it = dirs.begin(); it != dirs.end(); ++it) {
+        uint32_t mask = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+        ok = inotify_add_watch(m_fd, it->string().c_str(), mask) >= 0 && ok;
+    }
+    return ok;
+}
+
+bool
+FileNotifier::wait(unsigned int timeoutMs) {
+    if (m_fd < 0) {
+        usleep(timeoutMs * 1000);
+        return true;
+    }
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, (int) timeoutMs) <= 0) {
+        return false;
+    }
+    // drain, we only care that something happened
+    char buf[4096];
+    while (read(m_fd, buf, sizeof(buf)) > 0) {
+    }
+    return true;
+}
+
+#elif defined(MACOSX)
+
+FileNotifier::FileNotifier() : m_fd(-1) {
+}
+
+void
+FileNotifier::clear() {
+    for (std::vector<int>::const_iterator it = m_watched.begin(); it != m_watched.end(); ++it) {
+        close(*it);
+    }
+    m_watched.clear();
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool
+FileNotifier::watch(const std::vector<boost::filesystem::path>& files) {
+    clear();
+    m_fd = kqueue();
+    if (m_fd < 0) {
+        return false;
+    }
+    std::vector<boost::filesystem::path> all = parentDirs(files);
+    all.insert(all.end(), files.begin(), files.end());
+    bool ok = true;
+    for (std::vector<boost::filesystem::path>::const_iterator it = all.begin(); it != all.end(); ++it) {
+        int fd = open(it->string().c_str(), O_EVTONLY);
+        if (fd < 0) {
+            ok = false;
+            continue;
+        }
+        m_watched.push_back(fd);
+        struct kevent ev;
+        EV_SET(&ev, fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+               NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+        ok = kevent(m_fd, &ev, 1, NULL, 0, NULL) == 0 && ok;
+    }
+    return ok;
+}
+
+bool
+FileNotifier::wait(unsigned int timeoutMs) {
+    if (m_fd < 0) {
+        usleep(timeoutMs * 1000);
+        return true;
+    }
+    struct timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000;
+    struct kevent events[16];
+    int n = kevent(m_fd, NULL, 0, events, 16, &ts);
+    return n > 0;
+}
+
+#elif defined(WINDOWS)
+
+FileNotifier::FileNotifier() {
+}
+
+void
+FileNotifier::clear() {
+    for (std::vector<void*>::const_iterator it = m_handles.begin(); it != m_handles.end(); ++it) {
+        FindCloseChangeNotification((HANDLE) *it);
+    }
+    m_handles.clear();
+}
+
+bool
+FileNotifier::watch(const std::vector<boost::filesystem::path>& files) {
+    clear();
+    // windows only notifies on directories, a change to anything in a
+    // log dir wakes us.  that's fine, logs are what's in there.
+    std::vector<boost::filesystem::path> dirs = parentDirs(files);
+    bool ok = true;
+    for (std::vector<boost::filesystem::path>::const_iterator it = dirs.begin(); it != dirs.end(); ++it) {
+        if (m_handles.size() >= MAXIMUM_WAIT_OBJECTS) {
+            ok = false;
+            break;
+        }
+        HANDLE h = FindFirstChangeNotificationW(it->wstring().c_str(), FALSE,
+                                                FILE_NOTIFY_CHANGE_FILE_NAME
+                                                | FILE_NOTIFY_CHANGE_SIZE
+                                                | FILE_NOTIFY_CHANGE_LAST_WRITE);
+        if (h == INVALID_HANDLE_VALUE) {
+            ok = false;
+            continue;
+        }
+        m_handles.push_back(h);
+    }
+    return ok;
+}
+
+bool
+FileNotifier::wait(unsigned int timeoutMs) {
+    if (m_handles.empty()) {
+        Sleep(timeoutMs);
+        return true;
+    }
+    DWORD rv = WaitForMultipleObjects((DWORD) m_handles.size(), (const HANDLE*) &m_handles[0],
+                                      FALSE, timeoutMs);
+    if (rv < WAIT_OBJECT_0 || rv >= WAIT_OBJECT_0 + m_handles.size()) {
+        return false;
+    }
+    FindNextChangeNotification((HANDLE) m_handles[rv - WAIT_OBJECT_0]);
+    return true;
+}
+
+#else
+
+FileNotifier::FileNotifier() : m_fd(-1) {
+}
+
+void
+FileNotifier::clear() {
+}
+
+bool
+FileNotifier::watch(const std::vector<boost::filesystem::path>& /*files*/) {
+    return false;
+}
+
+bool
+FileNotifier::wait(unsigned int timeoutMs) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(timeoutMs));
+    return true;
+}
+
+#endif
+
+FileNotifier::~FileNotifier() {
+    clear();
+}
@@ -0,0 +1,100 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_WATCH_H__
+#define __LOGACCESS_WATCH_H__
+
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <ctime>
+#include <vector>
+
+namespace logaccess {
+
+// Watches a set of directories for entries being created, removed or
+// renamed.  On linux a single inotify instance shared by all watchers
+// is used, elsewhere (or if inotify is unavailable) the modification
+// times of the directories are compared against the ones seen when they
+// were added.
+class DirWatcher : boost::noncopyable {
+public:
+    DirWatcher();
+    ~DirWatcher();
+
+    // start watching dir.  returns false if dir can't be watched, in
+    // which case the caller shouldn't trust anything derived from it.
+    bool add(const boost::filesystem::path& dir);
+
+    // true if any watched directory has changed since it was added.
+    // once true, stays true.
+    bool changed();
+
+private:
+    struct Stamp {
+        boost::filesystem::path dir;
+        std::time_t mtime;
+    };
+    std::vector<Stamp> m_stamps;
+    bool m_changed;
+#ifdef LINUX
+    // read the shared instance's events, marking the watchers they're
+    // for as changed
+    static void readEvents();
+    bool m_inotify;
+    // watch descriptors (on the shared instance) of our directories
+    std::vector<int> m_wds;
+#endif
+};
+
+// Wakes a waiting thread when any of a set of files is written to,
+// replaced or removed.  inotify is used on linux, kqueue on osx and
+// change notifications on the files' directories on windows.  Elsewhere
+// wait() simply sleeps.
+class FileNotifier : boost::noncopyable {
+public:
+    FileNotifier();
+    ~FileNotifier();
+
+    // watch exactly these files (and their directories, to see them
+    // replaced), dropping anything watched before.  call again after a
+    // file has been replaced to watch the new one.
+    bool watch(const std::vector<boost::filesystem::path>& files);
+
+    // wait until something changes or timeoutMs passes.  returns true
+    // if woken by a change.
+    bool wait(unsigned int timeoutMs);
+
+private:
+    void clear();
+#ifdef WINDOWS
+    std::vector<void*> m_handles;
+#else
+    int m_fd;
+#endif
+#ifdef MACOSX
+    std::vector<int> m_watched;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#include "logaccess_whitelist.h"
+#include <boost/filesystem/fstream.hpp>
+#include <algorithm>
+
+using logaccess::Whitelist;
+
+static inline char
+lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c;
+}
+
+// compare an edge label (stored lower case) with [s, s + len) ignoring
+// the case of the latter
+static int
+compareLabel(const std::string& label, const char* s, std::size_t len) {
+    std::size_t n = std::min(label.size(), len);
+    for (std::size_t i = 0; i < n; i++) {
+        char c = lower(s[i]);
+        if (label[i] != c) {
+            return label[i] < c ? -1 : 1;
+        }
+    }
+    if (label.size() == len) {
+        return 0;
+    }
+    return label.size() < len ? -1 : 1;
+}
+
+Whitelist::Whitelist() : m_nodes(1) {
+}
+
+unsigned int
+Whitelist::find(unsigned int node, const char* label, std::size_t len) const {
+    const std::vector<Edge>& edges = m_nodes[node].edges;
+    std::size_t lo = 0, hi = edges.size();
+    while (lo < hi) {
+        std::size_t mid = (lo + hi) / 2;
+        int c = compareLabel(edges[mid].label, label, len);
+        if (c == 0) {
+            return edges[mid].child;
+        } else if (c < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return 0;
+}
+
+void
+Whitelist::add(const std::string& domain) {
+    std::string d;
+    for (std::string::const_iterator it = domain.begin(); it != domain.end(); ++it) {
+        d += lower(*it);
+    }
+    // tolerate "*.example.com", ".example.com" and "example.com."
+    if (d.compare(0, 2, "*.") == 0) {
+        d.erase(0, 2);
+    }
+    while (!d.empty() && d[0] == '.') {
+        d.erase(0, 1);
+    }
+    while (!d.empty() && d[d.size() - 1] == '.') {
+        d.erase(d.size() - 1);
+    }
+    if (d.empty()) {
+        return;
+    }
+    unsigned int node = 0;
+    std::size_t end = d.size();
+    for (;;) {
+        std::size_t dot = d.rfind('.', end - 1);
+        std::size_t start = (dot == std::string::npos) ? 0 : dot + 1;
+        std::string label = d.substr(start, end - start);
+        unsigned int child = label.empty() ? node : find(node, label.data(), label.size());
+        if (!label.empty() && child == 0) {
+            child = (unsigned int) m_nodes.size();
+            m_nodes.push_back(Node());
+            Edge e;
+            e.label = label;
+            e.child = child;
+            std::vector<Edge>& edges = m_nodes[node].edges;
+            std::vector<Edge>::iterator pos = edges.begin();
+            while (pos != edges.end() && pos->label < label) {
+                ++pos;
+            }
+            edges.insert(pos, e);
+        }
+        node = child;
+        if (dot == std::string::npos || dot == 0) {
+            break;
+        }
+        end = dot;
+    }
+    m_nodes[node].terminal = true;
+}
+
+bool
+Whitelist::load(const boost::filesystem::path& file) {
+    boost::filesystem::ifstream is(file);
+    if (!is) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(is, line)) {
+        std::string::size_type b = line.find_first_not_of(" \t\r");
+        if (b == std::string::npos || line[b] == '#') {
+            continue;
+        }
+        std::string::size_type e = line.find_last_not_of(" \t\r");
+        add(line.substr(b, e - b + 1));
+    }
+    return true;
+}
+
+bool
+Whitelist::allows(const std::string& host) const {
+    const char* h = host.data();
+    std::size_t end = host.size();
+    // a fully qualified "example.com." is example.com
+    if (end > 0 && h[end - 1] == '.') {
+        end--;
+    }
+    unsigned int node = 0;
+    while (end > 0) {
+        std::size_t start = end;
+        while (start > 0 && h[start - 1] != '.') {
+            start--;
+        }
+        node = find(node, h + start, end - start);
+        if (node == 0) {
+            return false;
+        }
+        // a label boundary always lies here, so evilbrowserplus.org
+        // never matches browserplus.org
+        if (m_nodes[node].terminal) {
+            return true;
+        }
+        if (start == 0) {
+            break;
+        }
+        end = start - 1;
+    }
+    return false;
+}
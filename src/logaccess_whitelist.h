@@ -0,0 +1,71 @@
+/**
+ * ***** BEGIN LICENSE BLOCK *****
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.1 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ * 
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See the
+ * License for the specific language governing rights and limitations
+ * under the License.
+ * 
+ * The Original Code is BrowserPlus (tm).
+ * 
+ * The Initial Developer of the Original Code is Yahoo!.
+ * Portions created by Yahoo! are Copyright (C) 2006-2010 Yahoo!.
+ * All Rights Reserved.
+ * 
+ * Contributor(s): 
+ * ***** END LICENSE BLOCK ***** */
+
+
+#ifndef __LOGACCESS_WHITELIST_H__
+#define __LOGACCESS_WHITELIST_H__
+
+#include <boost/filesystem.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace logaccess {
+
+// A set of domains, stored as a trie of their labels from the right
+// ("www.yahoo.com" is com -> yahoo -> www).  A host is allowed if it
+// is one of the domains or a subdomain of one, which is decided in a
+// single right to left walk of the host without allocating.
+class Whitelist {
+public:
+    Whitelist();
+
+    // allow domain and its subdomains
+    void add(const std::string& domain);
+
+    // add the domains listed in file, one per line.  blank lines and
+    // lines starting with '#' are ignored.
+    bool load(const boost::filesystem::path& file);
+
+    bool allows(const std::string& host) const;
+
+private:
+    struct Edge {
+        std::string label;
+        unsigned int child;
+    };
+    struct Node {
+        Node() : terminal(false) {}
+        // a whitelisted domain ends here
+        bool terminal;
+        // sorted by label
+        std::vector<Edge> edges;
+    };
+
+    // the child of node reached by label, or 0 (the root can't be a child)
+    unsigned int find(unsigned int node, const char* label, std::size_t len) const;
+
+    std::vector<Node> m_nodes;
+};
+
+}
+
+#endif
@@ -20,102 +20,1638 @@
  * ***** END LICENSE BLOCK ***** */
 
 #include "bpservice/bpservice.h"
+#include "bpservice/bpcallback.h"
 #include "bputil/bpurl.h"
+#include "bp-file/bpfile.h"
+#include "logaccess_bundle.h"
+#include "logaccess_chunks.h"
+#include "logaccess_columns.h"
+#include "logaccess_file.h"
+#include "logaccess_follow.h"
+#include "logaccess_index.h"
+#include "logaccess_line.h"
+#include "logaccess_lookup.h"
+#include "logaccess_pool.h"
+#include "logaccess_reader.h"
+#include "logaccess_search.h"
+#include "logaccess_signatures.h"
+#include "logaccess_stats.h"
+#include "logaccess_summary.h"
+#include "logaccess_tail.h"
+#include "logaccess_timeline.h"
 #include "logaccess_util.h"
+#include "logaccess_whitelist.h"
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <ctime>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
 
 // our service
 class LogAccess : public bplus::service::Service {
 public:
     BP_SERVICE(LogAccess);
-    LogAccess() : bplus::service::Service() {}
-    ~LogAccess() {}
+    LogAccess() : bplus::service::Service(), m_lookups(logaccess::LogLookups::shared()),
+                  m_canceller(new logaccess::Canceller), m_bundles(0) {}
+    ~LogAccess();
 public:
     void get(const bplus::service::Transaction& tran, const bplus::Map& args);
     void getServiceLogs(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void tail(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void grep(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void follow(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void getBundle(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void range(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void query(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void timeline(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void summary(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void diagnose(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void manifest(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void fetchChunks(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void read(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void stats(const bplus::service::Transaction& tran, const bplus::Map& args);
+    void resetStats(const bplus::service::Transaction& tran, const bplus::Map& args);
+private:
+    // finish a get once the platform logs are found
+    static void gotLogs(bplus::service::Transaction tran, boost::posix_time::ptime start,
+                        const logaccess::Listing& listing);
+
+    // a getServiceLogs transaction waiting on the lookups of its services
+    struct ServiceLogsJob {
+        explicit ServiceLogsJob(const bplus::service::Transaction& t) : tran(t), remaining(0) {}
+        bplus::service::Transaction tran;
+        boost::posix_time::ptime start;
+        std::vector<std::string> services;
+        boost::mutex lock;
+        std::vector<boost::shared_ptr<bplus::List> > paths;
+        std::vector<std::string> errors;
+        unsigned int remaining;
+    };
+    // record what was found for job->services[i], finishing the job
+    // once all are in
+    static void gotServiceLogs(boost::shared_ptr<ServiceLogsJob> job, unsigned int i,
+                               const logaccess::Listing& listing);
+
+    struct GrepResult {
+        GrepResult() : complete(true) {}
+        std::vector<logaccess::SearchMatch> matches;
+        bool complete;
+        std::string error;
+    };
+    // search files[i] into results[i], run from the worker pool
+    static void grepFile(const logaccess::LineSearcher& searcher, std::size_t max,
+                         const std::vector<boost::filesystem::path>& files,
+                         std::vector<GrepResult>& results, unsigned int i);
+
+    struct DiagnoseResult {
+        std::vector<logaccess::SignatureHit> hits;
+        std::string error;
+    };
+    // scan files[i] into results[i], run from the worker pool
+    static void diagnoseFile(const logaccess::Signatures& signatures,
+                             const std::vector<boost::filesystem::path>& files,
+                             std::vector<DiagnoseResult>& results, unsigned int i);
+
+    struct FollowJob {
+        boost::shared_ptr<logaccess::Follower> follower;
+        boost::shared_ptr<boost::thread> thread;
+    };
+    // runs on a FollowJob's thread for the life of a follow transaction
+    static void runFollower(boost::shared_ptr<logaccess::Follower> follower,
+                            bplus::service::Transaction tran, unsigned int durationMs);
+    // hands a batch of new log data to the page
+    static void sendChunks(boost::shared_ptr<bplus::service::Callback> cb,
+                           const std::vector<logaccess::FollowChunk>& chunks);
+
+    // the logfiles a read method works on: the ones named in "files",
+    // which must be platform logs or logs of the services named in
+    // "services", or all of those if "files" isn't given.  reports any
+    // error on tran and returns false.
+    bool selectLogFiles(const bplus::service::Transaction& tran, const bplus::Map& args,
+                        std::vector<boost::filesystem::path>& files);
+
+    // whether the page we serve may use us, the answer for each of
+    // the last kMaxOrigins client uris is worked out once
+    bool allowed();
+    boost::mutex m_originLock;
+    std::map<std::string, bool> m_origins;
+
+    // finds where the logs live, shared with the other instances.  the
+    // first instance created starts it finding them in the background.
+    boost::shared_ptr<logaccess::LogLookups> m_lookups;
+
+    // lookups answer through this, it's cancelled when we go away
+    boost::shared_ptr<logaccess::Canceller> m_canceller;
+
+    // time indexes of the logs range has been asked about
+    logaccess::TimeIndexCache m_indexes;
+
+    // logs parsed into columns for query
+    logaccess::ColumnCache m_columns;
+
+    // chunk digests of the logs manifest and fetchChunks have been
+    // asked about
+    logaccess::ChunkCache m_chunks;
+
+    // bundles written so far, keeps their names unique.  only the
+    // latest is kept, it's removed when the next is made or we go away.
+    boost::mutex m_bundleLock;
+    unsigned int m_bundles;
+    boost::filesystem::path m_lastBundle;
+
+    // follow transactions in progress, stopped when we go away
+    boost::mutex m_followLock;
+    std::vector<FollowJob> m_follows;
 };
 
-BP_SERVICE_DESC(LogAccess, "LogAccess", "1.3.0",
+BP_SERVICE_DESC(LogAccess, "LogAccess", "2.0.0",
                 "Lets you get file handles for BrowserPlus log files "
                 "from a webpage.")
 ADD_BP_METHOD(LogAccess, get,
               "Returns a list in \"files\" of filehandles associated "
-              "with BrowserPlus logfiles.")
+              "with BrowserPlus logfiles.  A lookup is abandoned only when "
+              "the service instance goes away, not when a single call "
+              "stops being waited for.")
+ADD_BP_METHOD_ARG(get, "details", Boolean, false,
+                  "Return a map for each file rather than just its "
+                  "filehandle, holding the \"path\", \"size\", "
+                  "\"modified\" time (milliseconds since 1970), an "
+                  "estimate of the number of \"lines\" and the "
+                  "\"component\" that writes it (\"platform/<version>\" "
+                  "or \"<service>/<major version>\").  Defaults to false.")
 ADD_BP_METHOD(LogAccess, getServiceLogs,
-              "Returns a list in \"files\" of filehandles associated "
-              "with BrowserPlus service logfiles.")
+              "Returns a map keyed by service name.  Each value is a map "
+              "holding either a list in \"files\" of filehandles associated "
+              "with the service's logfiles, or an \"error\" string if they "
+              "couldn't be found.  As with get, lookups are abandoned only "
+              "when the service instance goes away.")
 ADD_BP_METHOD_ARG(getServiceLogs, "services", List, true,
                   "A list of service names whose logs are fetched.")
+ADD_BP_METHOD_ARG(getServiceLogs, "details", Boolean, false,
+                  "Return a map of details for each file rather than just "
+                  "its filehandle, as get does.  Defaults to false.")
+ADD_BP_METHOD(LogAccess, tail,
+              "Returns a list of maps, one per logfile, holding the file's "
+              "\"path\", its \"size\", and in \"data\" the end of the "
+              "file starting at \"offset\".")
+ADD_BP_METHOD_ARG(tail, "lines", Integer, false,
+                  "How many lines to return from the end of each file.  "
+                  "Defaults to 100 if neither lines nor bytes are given.")
+ADD_BP_METHOD_ARG(tail, "bytes", Integer, false,
+                  "The most bytes to return from the end of each file.")
+ADD_BP_METHOD_ARG(tail, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to tail.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(tail, "services", List, false,
+                  "A list of service names whose logs may be tailed.")
+ADD_BP_METHOD(LogAccess, grep,
+              "Searches logfiles for lines containing any of a set of "
+              "strings.  Returns a map holding a list in \"matches\" of "
+              "maps with the \"path\", \"line\" number, byte \"offset\" "
+              "and \"text\" of each matching line, and a \"truncated\" "
+              "boolean that is true if maxMatches was reached.")
+ADD_BP_METHOD_ARG(grep, "patterns", List, true,
+                  "A list of literal strings to search for.")
+ADD_BP_METHOD_ARG(grep, "ignoreCase", Boolean, false,
+                  "Match letters regardless of case.  Defaults to false.")
+ADD_BP_METHOD_ARG(grep, "maxMatches", Integer, false,
+                  "The most matching lines to return.  Defaults to 1000.")
+ADD_BP_METHOD_ARG(grep, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to search.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(grep, "services", List, false,
+                  "A list of service names whose logs may be searched.")
+ADD_BP_METHOD(LogAccess, follow,
+              "Watches logfiles and passes data appended to them to "
+              "\"callback\" as it is written, in batches.  Each callback "
+              "gets a list of maps holding a file's \"path\", the "
+              "\"offset\" and \"data\" of the new lines, and \"reset\", "
+              "true when the file was rotated or truncated and data starts "
+              "from the beginning of the new file.  Completes when "
+              "\"duration\" runs out, returning a list of maps holding "
+              "the \"path\" and \"offset\" read up to for each file.  "
+              "Fails with bp.busy while 8 follows are already running.")
+ADD_BP_METHOD_ARG(follow, "callback", CallBack, true,
+                  "Called with each batch of new log data.")
+ADD_BP_METHOD_ARG(follow, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to follow.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(follow, "services", List, false,
+                  "A list of service names whose logs may be followed.")
+ADD_BP_METHOD_ARG(follow, "offsets", List, false,
+                  "Where to start in each of \"files\", as returned by a "
+                  "previous follow.  Defaults to the current end of each file.")
+ADD_BP_METHOD_ARG(follow, "interval", Integer, false,
+                  "Milliseconds to gather writes into a single batch.  "
+                  "Defaults to 250.")
+ADD_BP_METHOD_ARG(follow, "maxBatch", Integer, false,
+                  "The most bytes of a file passed in a single batch.  "
+                  "Defaults to 65536.")
+ADD_BP_METHOD_ARG(follow, "duration", Integer, false,
+                  "Seconds to follow for, at most 3600.  Defaults to 60.")
+ADD_BP_METHOD(LogAccess, getBundle,
+              "Compresses all BrowserPlus logfiles, and those of "
+              "\"services\", into a single zip archive.  Returns a map "
+              "holding the archive's filehandle in \"bundle\", the number "
+              "of \"files\" in it, their \"originalSize\", the "
+              "\"compressedSize\" of the archive, the compression "
+              "\"ratio\" and the \"elapsedMs\" it took.  The archive is "
+              "deleted by the next getBundle call or when the service "
+              "instance goes away.")
+ADD_BP_METHOD_ARG(getBundle, "services", List, false,
+                  "A list of service names whose logs are included.")
+ADD_BP_METHOD(LogAccess, range,
+              "Returns the lines of each logfile logged between \"start\" "
+              "and \"end\", as a list of maps holding the file's \"path\", "
+              "the \"data\" and the \"offset\" it starts at, and "
+              "\"truncated\", true if maxBytes was reached.  Lines without "
+              "a timestamp go with the line before them.")
+ADD_BP_METHOD_ARG(range, "start", String, true,
+                  "The earliest time wanted, as \"YYYY-MM-DD HH:MM:SS[.mmm]\" "
+                  "in the logs' local time.")
+ADD_BP_METHOD_ARG(range, "end", String, true,
+                  "The latest time wanted, in the same form as start.")
+ADD_BP_METHOD_ARG(range, "maxBytes", Integer, false,
+                  "The most bytes returned per file.  Defaults to 1048576.")
+ADD_BP_METHOD_ARG(range, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to read.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(range, "services", List, false,
+                  "A list of service names whose logs may be read.")
+ADD_BP_METHOD(LogAccess, query,
+              "Returns the log lines matching every given filter.  Returns a "
+              "map holding the total \"count\" of matching lines and, unless "
+              "countOnly is set, a list in \"lines\" of maps with the "
+              "\"path\", \"offset\", \"time\" (milliseconds since 1970 "
+              "in the logs' local time), \"level\", \"thread\", "
+              "\"category\" and \"message\" of each of the first \"limit\" "
+              "of them.")
+ADD_BP_METHOD_ARG(query, "minLevel", String, false,
+                  "Only lines at or above this level: DEBUG, INFO, WARN, "
+                  "ERROR or FATAL.")
+ADD_BP_METHOD_ARG(query, "categories", List, false,
+                  "Only lines in one of these categories (source file names "
+                  "without extension).")
+ADD_BP_METHOD_ARG(query, "threads", List, false,
+                  "Only lines logged by one of these thread ids.")
+ADD_BP_METHOD_ARG(query, "start", String, false,
+                  "Only lines logged at or after this \"YYYY-MM-DD HH:MM:SS\" time.")
+ADD_BP_METHOD_ARG(query, "end", String, false,
+                  "Only lines logged at or before this \"YYYY-MM-DD HH:MM:SS\" time.")
+ADD_BP_METHOD_ARG(query, "countOnly", Boolean, false,
+                  "Return only the count.  Defaults to false.")
+ADD_BP_METHOD_ARG(query, "limit", Integer, false,
+                  "The most lines returned.  Defaults to 1000.")
+ADD_BP_METHOD_ARG(query, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to query.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(query, "services", List, false,
+                  "A list of service names whose logs may be queried.")
+ADD_BP_METHOD(LogAccess, timeline,
+              "Merges logfiles, and the rotated copies of each "
+              "(<name>.1, <name>.2 ...), into a single list of lines "
+              "ordered by time.  Each line is a map holding the \"path\" "
+              "and \"offset\" it was read from, its \"time\" "
+              "(milliseconds since 1970 in the logs' local time, missing "
+              "before a file's first timestamp) and its \"text\".  Lines "
+              "without a timestamp take the time of the line before them.  "
+              "Returns a map holding the \"count\" of lines, "
+              "\"truncated\", true if limit was reached, and unless a "
+              "callback is given the \"lines\" themselves.")
+ADD_BP_METHOD_ARG(timeline, "start", String, false,
+                  "Only lines logged at or after this \"YYYY-MM-DD HH:MM:SS\" time.")
+ADD_BP_METHOD_ARG(timeline, "end", String, false,
+                  "Only lines logged at or before this \"YYYY-MM-DD HH:MM:SS\" time.")
+ADD_BP_METHOD_ARG(timeline, "limit", Integer, false,
+                  "The most lines returned, at most 100000.  Defaults to 1000.")
+ADD_BP_METHOD_ARG(timeline, "callback", CallBack, false,
+                  "Invoked with lists of lines as they are merged, rather "
+                  "than returning them all at the end.")
+ADD_BP_METHOD_ARG(timeline, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to merge.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(timeline, "services", List, false,
+                  "A list of service names whose logs may be merged.")
+ADD_BP_METHOD(LogAccess, summary,
+              "Returns an overview of each logfile: a list of maps holding "
+              "its \"path\", \"size\", number of \"lines\", a map of "
+              "\"levels\" counting the lines at each level (lines without "
+              "a timestamp aren't counted, those at an unknown level are "
+              "counted as UNKNOWN), the \"first\" and \"last\" "
+              "times logged (milliseconds since 1970 in the logs' local "
+              "time, missing if there are none) and in \"top\" a list of "
+              "maps holding the \"message\" and \"count\" of the most "
+              "frequent messages, with numbers replaced by '#', most "
+              "frequent first, out of the \"distinct\" messages found.")
+ADD_BP_METHOD_ARG(summary, "top", Integer, false,
+                  "How many of the most frequent messages to return, at "
+                  "most 100.  Defaults to 10.")
+ADD_BP_METHOD_ARG(summary, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to summarize.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(summary, "services", List, false,
+                  "A list of service names whose logs may be summarized.")
+ADD_BP_METHOD(LogAccess, diagnose,
+              "Scans logfiles for known failures.  Returns a list of maps "
+              "holding the \"path\" of each file and in \"signatures\" "
+              "a list of maps holding the \"id\" of each failure found, "
+              "the \"count\" of times it was found and the \"first\" "
+              "and \"last\" offsets it was found at.")
+ADD_BP_METHOD_ARG(diagnose, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to scan.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(diagnose, "services", List, false,
+                  "A list of service names whose logs may be scanned.")
+ADD_BP_METHOD(LogAccess, manifest,
+              "Describes logfiles as chunks, so a caller that has fetched "
+              "them before can fetch only what's new.  Chunks are cut "
+              "where the content says, so appending to a log leaves all "
+              "but its last chunk as they were.  Returns a list of maps "
+              "holding the \"path\", \"size\", \"modified\" time "
+              "(milliseconds since 1970) and in \"chunks\" a list of "
+              "maps holding the \"offset\", \"length\" and SHA-1 "
+              "\"digest\" of each chunk of each file.")
+ADD_BP_METHOD_ARG(manifest, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to describe.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(manifest, "services", List, false,
+                  "A list of service names whose logs may be described.")
+ADD_BP_METHOD(LogAccess, fetchChunks,
+              "Returns the chunks of logfiles (see manifest) the caller "
+              "doesn't have yet: a map holding in \"chunks\" a list of "
+              "maps with the \"path\", \"offset\", \"length\", "
+              "\"digest\" and \"data\" of each, in file and offset "
+              "order, and \"truncated\", true if maxBytes was reached "
+              "first.  A chunk found in several places is sent once.")
+ADD_BP_METHOD_ARG(fetchChunks, "have", List, false,
+                  "Digests of the chunks the caller already has.")
+ADD_BP_METHOD_ARG(fetchChunks, "maxBytes", Integer, false,
+                  "The most data returned, at most 16MB.  Defaults to 4MB.  "
+                  "At least one missing chunk is returned, however big.")
+ADD_BP_METHOD_ARG(fetchChunks, "files", List, false,
+                  "Logfiles (as returned by get or getServiceLogs) to fetch.  "
+                  "Defaults to all platform logs and the logs of \"services\".")
+ADD_BP_METHOD_ARG(fetchChunks, "services", List, false,
+                  "A list of service names whose logs may be fetched.")
+ADD_BP_METHOD(LogAccess, read,
+              "Reads a logfile a chunk at a time, the caller asking for "
+              "the next chunk when it's ready for it.  Returns a map "
+              "holding the \"data\", the \"offset\" it was read from, "
+              "the \"next\" offset to read from and \"eof\", true if "
+              "the data reaches the end of the file.  Chunks end on a line "
+              "boundary unless they reach the end of the file or a single "
+              "line is longer than maxBytes.  Fails with bp.busy while 8 "
+              "reads are already in progress.")
+ADD_BP_METHOD_ARG(read, "file", Path, true,
+                  "The logfile (as returned by get or getServiceLogs) to read.")
+ADD_BP_METHOD_ARG(read, "offset", Integer, false,
+                  "Where to read from, the start of a line (0 or the next "
+                  "offset of the previous chunk).  Defaults to 0.")
+ADD_BP_METHOD_ARG(read, "maxBytes", Integer, false,
+                  "The largest chunk returned, at most 1MB.  Defaults to 256KB.")
+ADD_BP_METHOD_ARG(read, "services", List, false,
+                  "A list of service names whose logs may be read.")
+ADD_BP_METHOD(LogAccess, stats,
+              "Returns a map keyed by method name of what each method has "
+              "cost since the service was loaded or resetStats was last "
+              "called: the number of \"calls\", their total \"timeUs\", "
+              "estimated \"p50Us\", \"p90Us\" and \"p99Us\" latencies, a "
+              "\"latency\" histogram of maps holding a \"count\" of calls "
+              "taking less than \"underUs\", the \"dirsOpened\", "
+              "\"entriesScanned\", \"statCalls\", \"bytesRead\", "
+              "\"cacheHits\" and \"cacheMisses\", and a map of "
+              "\"errors\" counted by error code.  Discovery done in the "
+              "background when the service loads is reported as "
+              "\"warmUp\", other work done outside any method as "
+              "\"other\".")
+ADD_BP_METHOD(LogAccess, resetStats,
+              "Starts the counts returned by stats over from zero.")
 END_BP_SERVICE_DESC
 
+// how many lines tail returns when not told
+static const long long kDefaultTailLines = 100;
+
+// follow's batching and lifetime limits
+static const long long kDefaultFollowIntervalMs = 250;
+static const long long kMaxFollowIntervalMs = 10000;
+static const long long kDefaultFollowBatch = 64 * 1024;
+static const long long kMaxFollowBatch = 1024 * 1024;
+static const long long kDefaultFollowSeconds = 60;
+static const long long kMaxFollowSeconds = 3600;
+// follows running at once, across all instances.  each holds a thread
+// for up to kMaxFollowSeconds.
+static const unsigned int kMaxFollows = 8;
+
+// how much range returns per file when not told, and at most
+static const long long kDefaultRangeBytes = 1024 * 1024;
+static const long long kMaxRangeBytes = 4 * 1024 * 1024;
+
+// how many lines query returns when not told, and at most
+static const long long kDefaultQueryLines = 1000;
+static const long long kMaxQueryLines = 10000;
+
+// how many lines timeline returns when not told, and at most.  with a
+// callback they're passed on kTimelineBatch at a time.
+static const long long kDefaultTimelineLines = 1000;
+static const long long kMaxTimelineLines = 100000;
+static const unsigned int kTimelineBatch = 256;
+
+// how much fetchChunks returns when not told, and at most
+static const long long kDefaultFetchBytes = 4 * 1024 * 1024;
+static const long long kMaxFetchBytes = 16 * 1024 * 1024;
+
+// how much read returns when not told, and at most.  at most kMaxReads
+// run at once, later ones fail with bp.busy.
+static const long long kDefaultReadBytes = 256 * 1024;
+static const long long kMaxReadBytes = 1024 * 1024;
+static const unsigned int kMaxReads = 8;
+
+// how many frequent messages summary returns when not told, and at most
+static const long long kDefaultSummaryTop = 10;
+static const long long kMaxSummaryTop = 100;
+
+// how many matching lines grep returns when not told, and at most
+static const long long kDefaultGrepMatches = 1000;
+static const long long kMaxGrepMatches = 10000;
+
+// how much of a log grep reads at a time
+static const std::size_t kGrepBlock = 1024 * 1024;
+
+// origins whose whitelist decision an instance remembers, past this the
+// decisions are forgotten and made afresh
+static const std::size_t kMaxOrigins = 64;
+
+// an optional Integer argument, false if it wasn't given
 static bool
-checkWhitelist(const std::string& sUrl) {
-    bplus::url::Url pUrl;
-    if (!pUrl.parse(sUrl)) {
+integerArg(const bplus::Map& args, const char* key, long long& value) {
+    const bplus::Integer* i = dynamic_cast<const bplus::Integer*>(args.value(key));
+    if (!i) {
         return false;
     }
-    if (pUrl.scheme() != "http" && pUrl.scheme() != "https") {
+    value = i->value();
+    return true;
+}
+
+// an optional String argument, false if it wasn't given
+static bool
+stringArg(const bplus::Map& args, const char* key, std::string& value) {
+    const bplus::String* s = dynamic_cast<const bplus::String*>(args.value(key));
+    if (!s) {
         return false;
     }
-    std::vector<std::string> whitelist;
-    whitelist.push_back("yahoo.com");    
-    whitelist.push_back("browserplus.org");
-    whitelist.push_back("browserpl.us");
-    whitelist.push_back("localhost");
-    for (std::vector<std::string>::const_iterator i = whitelist.begin(); i != whitelist.end(); i++) {
-        if (i->length() > pUrl.host().length()) {
-            continue;
-        }
-        // if the hostname is larger than the whitelist entry it must
-        // have a separator (so suckbrowserplus.org isn't whitelisted
-        // for browserplus.org entry)
-        if (i->length() < pUrl.host().length() &&
-            '.' != pUrl.host()[pUrl.host().length() - i->length() - 1]) {
-            continue;
+    value = s->value();
+    return true;
+}
+
+// the strings in an optional List argument
+static void
+stringSetArg(const bplus::Map& args, const char* key, std::set<std::string>& values) {
+    const bplus::List* l = NULL;
+    if (!args.getList(key, l)) {
+        return;
+    }
+    for (unsigned int i = 0; i < l->size(); i++) {
+        const bplus::String* s = dynamic_cast<const bplus::String*>(l->value(i));
+        if (s) {
+            values.insert(s->value());
         }
-        if (!pUrl.host().substr(pUrl.host().length() - i->length(),
-                                i->length()).compare(*i)) {
-            return true;
+    }
+}
+
+// an optional Boolean argument, false if it wasn't given
+static bool
+boolArg(const bplus::Map& args, const char* key, bool& value) {
+    const bplus::Bool* b = dynamic_cast<const bplus::Bool*>(args.value(key));
+    if (!b) {
+        return false;
+    }
+    value = b->value();
+    return true;
+}
+
+// clamp an optional Integer argument to [1, max], dflt if not given
+static long long
+boundedArg(const bplus::Map& args, const char* key, long long dflt, long long max) {
+    long long value = dflt;
+    integerArg(args, key, value);
+    return value < 1 ? 1 : (value > max ? max : value);
+}
+
+// report an error on tran, counted against the method we work for
+static void
+fail(const bplus::service::Transaction& tran, const char* code, const char* msg) {
+    logaccess::stats::error(code);
+    tran.error(code, msg);
+}
+
+// the domains pages may use us from, built once and shared by all
+// instances.  <serviceDir>/whitelist.txt, if present, adds to these.
+static boost::mutex s_whitelistLock;
+static boost::shared_ptr<const logaccess::Whitelist> s_whitelist;
+
+static boost::shared_ptr<const logaccess::Whitelist>
+sharedWhitelist(const boost::filesystem::path& serviceDir) {
+    boost::mutex::scoped_lock lock(s_whitelistLock);
+    if (!s_whitelist) {
+        boost::shared_ptr<logaccess::Whitelist> w(new logaccess::Whitelist);
+        w->add("yahoo.com");
+        w->add("browserplus.org");
+        w->add("browserpl.us");
+        w->add("localhost");
+        w->load(serviceDir / "whitelist.txt");
+        s_whitelist = w;
+    }
+    return s_whitelist;
+}
+
+// the failures diagnose knows, built once and shared by all instances.
+// <serviceDir>/signatures.txt, if present, adds to these.
+static const char* kDefaultSignatures[][2] = {
+    { "crash.segfault", "Segmentation fault" },
+    { "crash.segfault", "SIGSEGV" },
+    { "crash.segfault", "EXC_BAD_ACCESS" },
+    { "crash.segfault", "Access violation" },
+    { "crash.abort", "SIGABRT" },
+    { "crash.abort", "Assertion failed" },
+    { "crash.outOfMemory", "std::bad_alloc" },
+    { "crash.outOfMemory", "out of memory" },
+    { "permission.denied", "Permission denied" },
+    { "permission.denied", "Access is denied" },
+    { "disk.full", "No space left on device" },
+    { "disk.full", "There is not enough space on the disk" },
+    { "proxy.authRequired", "407 Proxy Authentication Required" },
+    { "proxy.unreachable", "proxy connection failed" },
+    { "network.timeout", "timed out" },
+    { "network.dns", "Host not found" },
+    { "network.dns", "getaddrinfo failed" },
+    { "network.certificate", "certificate verify failed" },
+    { "service.installFailed", "failed to install service" },
+    { "service.installFailed", "service install failed" },
+    { "service.loadFailed", "failed to load service" },
+    { "service.loadFailed", "couldn't load service" },
+    { "service.signatureInvalid", "signature verification failed" },
+    { "ipc.brokenPipe", "Broken pipe" },
+    { NULL, NULL }
+};
+
+static boost::mutex s_signaturesLock;
+static boost::shared_ptr<const logaccess::Signatures> s_signatures;
+
+static boost::shared_ptr<const logaccess::Signatures>
+sharedSignatures(const boost::filesystem::path& serviceDir) {
+    boost::mutex::scoped_lock lock(s_signaturesLock);
+    if (!s_signatures) {
+        boost::shared_ptr<logaccess::Signatures> s(new logaccess::Signatures);
+        for (unsigned int i = 0; kDefaultSignatures[i][0]; i++) {
+            s->add(kDefaultSignatures[i][0], kDefaultSignatures[i][1]);
         }
+        s->load(serviceDir / "signatures.txt");
+        s->compile();
+        s_signatures = s;
+    }
+    return s_signatures;
+}
+
+bool
+LogAccess::allowed() {
+    std::string uri = clientUri();
+    boost::mutex::scoped_lock lock(m_originLock);
+    std::map<std::string, bool>::const_iterator it = m_origins.find(uri);
+    if (it != m_origins.end()) {
+        logaccess::stats::count(logaccess::stats::kCacheHits);
+        return it->second;
+    }
+    logaccess::stats::count(logaccess::stats::kCacheMisses);
+    bool ok = false;
+    bplus::url::Url pUrl;
+    if (pUrl.parse(uri) && (pUrl.scheme() == "http" || pUrl.scheme() == "https")) {
+        ok = sharedWhitelist(boost::filesystem::path(serviceDir()))->allows(pUrl.host());
+    }
+    if (m_origins.size() >= kMaxOrigins) {
+        m_origins.clear();
+    }
+    m_origins[uri] = ok;
+    return ok;
+}
+
+LogAccess::~LogAccess() {
+    // lookups still running finish without us.  this is the only
+    // cancellation there is, the framework doesn't tell us when a single
+    // transaction is abandoned.
+    m_canceller->cancel();
+    // callbacks and transactions die with us, nothing left to follow for
+    std::vector<FollowJob> follows;
+    {
+        boost::mutex::scoped_lock lock(m_followLock);
+        follows.swap(m_follows);
+    }
+    for (std::vector<FollowJob>::const_iterator it = follows.begin(); it != follows.end(); ++it) {
+        it->follower->stop();
+    }
+    for (std::vector<FollowJob>::const_iterator it = follows.begin(); it != follows.end(); ++it) {
+        it->thread->join();
+    }
+    if (!m_lastBundle.empty()) {
+        boost::system::error_code ec;
+        boost::filesystem::remove(m_lastBundle, ec);
     }
-    return false;
 }
 
 void
 LogAccess::get(const bplus::service::Transaction& tran, const bplus::Map& args) {
-    if (!checkWhitelist(clientUri()) ) {
-        tran.error("bp.permissionDenied", NULL);
+    logaccess::stats::Call call(logaccess::stats::kGet);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
         return;
     }
-    bplus::List paths;
-    std::string error = logaccess::util::getLogfilePaths(paths);
-    if (!error.empty()) {
-        tran.error("bp.couldntGetLogs", error.c_str());
-        return;
+    bool details = false;
+    boolArg(args, "details", details);
+    call.defer();
+    m_lookups->lookup(std::string(), details, logaccess::stats::kGet, m_canceller,
+                      boost::bind(&LogAccess::gotLogs, tran, call.start(), _1));
+}
+
+void
+LogAccess::gotLogs(bplus::service::Transaction tran, boost::posix_time::ptime start,
+                   const logaccess::Listing& listing) {
+    logaccess::stats::Attach attach(logaccess::stats::kGet);
+    // counted before the caller hears back, so stats asked for next
+    // include this call
+    logaccess::stats::record(logaccess::stats::kGet, start);
+    if (!listing.error.empty()) {
+        fail(tran, "bp.couldntGetLogs", listing.error.c_str());
+    } else {
+        tran.complete(listing.paths);
     }
-    tran.complete(paths);
 }
 
 void
 LogAccess::getServiceLogs(const bplus::service::Transaction& tran, const bplus::Map& args) {
-    if (!checkWhitelist(clientUri()) ) {
-        tran.error("bp.permissionDenied", NULL);
+    logaccess::stats::Call call(logaccess::stats::kGetServiceLogs);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
         return;
     }
     const bplus::List* serviceList = NULL;
     if (!args.getList("services", serviceList)) {
-        tran.error("bp.couldntGetLogs", "required services parameter missing");
+        fail(tran, "bp.couldntGetLogs", "required services parameter missing");
         return;
     }
-    bplus::List paths;
+    // each distinct service is resolved on its own, so one that can't be
+    // found doesn't cost the others their results
+    std::vector<std::string> services;
+    std::set<std::string> seen;
     for (unsigned int i = 0; i < serviceList->size(); i++) {
         const bplus::String* s = dynamic_cast<const bplus::String*>(serviceList->value(i));
-        if (s) {
-            std::string error = logaccess::util::getServiceLogfilePaths(s->value(), paths);
+        if (s && seen.insert(s->value()).second) {
+            services.push_back(s->value());
+        }
+    }
+    if (services.empty()) {
+        tran.complete(bplus::Map());
+        return;
+    }
+    bool details = false;
+    boolArg(args, "details", details);
+    boost::shared_ptr<ServiceLogsJob> job(new ServiceLogsJob(tran));
+    job->start = call.start();
+    job->services = services;
+    job->paths.resize(services.size());
+    job->errors.resize(services.size());
+    job->remaining = services.size();
+    call.defer();
+    for (unsigned int i = 0; i < services.size(); i++) {
+        m_lookups->lookup(services[i], details, logaccess::stats::kGetServiceLogs,
+                          m_canceller, boost::bind(&LogAccess::gotServiceLogs, job, i, _1));
+    }
+}
+
+void
+LogAccess::gotServiceLogs(boost::shared_ptr<ServiceLogsJob> job, unsigned int i,
+                          const logaccess::Listing& listing) {
+    {
+        boost::mutex::scoped_lock lock(job->lock);
+        job->paths[i].reset(new bplus::List(listing.paths));
+        job->errors[i] = listing.error;
+        if (--job->remaining > 0) {
+            return;
+        }
+    }
+    logaccess::stats::Attach attach(logaccess::stats::kGetServiceLogs);
+    bplus::Map results;
+    for (unsigned int j = 0; j < job->services.size(); j++) {
+        bplus::Map* m = new bplus::Map;
+        if (job->errors[j].empty()) {
+            m->add("files", new bplus::List(*job->paths[j]));
+        } else {
+            m->add("error", new bplus::String(job->errors[j]));
+        }
+        results.add(job->services[j], m);
+    }
+    logaccess::stats::record(logaccess::stats::kGetServiceLogs, job->start);
+    job->tran.complete(results);
+}
+
+bool
+LogAccess::selectLogFiles(const bplus::service::Transaction& tran, const bplus::Map& args,
+                          std::vector<boost::filesystem::path>& files) {
+    bplus::List paths;
+    std::string error = m_lookups->cache().getLogfilePaths(paths);
+    if (!error.empty()) {
+        fail(tran, "bp.couldntGetLogs", error.c_str());
+        return false;
+    }
+    const bplus::List* serviceList = NULL;
+    if (args.getList("services", serviceList)) {
+        for (unsigned int i = 0; i < serviceList->size(); i++) {
+            const bplus::String* s = dynamic_cast<const bplus::String*>(serviceList->value(i));
+            if (s) {
+                error = m_lookups->cache().getServiceLogfilePaths(s->value(), paths);
+                if (!error.empty()) {
+                    fail(tran, "bp.couldntGetLogs", error.c_str());
+                    return false;
+                }
+            }
+        }
+    }
+    std::set<boost::filesystem::path> allowed;
+    for (unsigned int i = 0; i < paths.size(); i++) {
+        const bplus::Path* p = dynamic_cast<const bplus::Path*>(paths.value(i));
+        if (p) {
+            allowed.insert(boost::filesystem::path(p->value()));
+        }
+    }
+    const bplus::List* fileList = NULL;
+    if (!args.getList("files", fileList)) {
+        files.assign(allowed.begin(), allowed.end());
+        return true;
+    }
+    for (unsigned int i = 0; i < fileList->size(); i++) {
+        const bplus::Path* p = dynamic_cast<const bplus::Path*>(fileList->value(i));
+        if (!p || !allowed.count(boost::filesystem::path(p->value()))) {
+            // only logfiles may be read thru this service
+            fail(tran, "bp.permissionDenied", "not a BrowserPlus logfile");
+            return false;
+        }
+        files.push_back(boost::filesystem::path(p->value()));
+    }
+    return true;
+}
+
+void
+LogAccess::tail(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kTail);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    long long lines = 0, bytes = 0;
+    bool haveLines = integerArg(args, "lines", lines);
+    bool haveBytes = integerArg(args, "bytes", bytes);
+    if (lines < 0 || bytes < 0) {
+        fail(tran, "bp.invalidArguments", "lines and bytes may not be negative");
+        return;
+    }
+    if (!haveLines && !haveBytes) {
+        lines = kDefaultTailLines;
+    }
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    bplus::List results;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        logaccess::TailResult tr;
+        std::string error = logaccess::tail(*it, lines, bytes, tr);
+        if (!error.empty()) {
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(*it)));
+        m->add("size", new bplus::Integer(tr.size));
+        m->add("offset", new bplus::Integer(tr.offset));
+        m->add("data", new bplus::String(tr.data));
+        results.append(m);
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::grep(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kGrep);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    const bplus::List* patternList = NULL;
+    if (!args.getList("patterns", patternList)) {
+        fail(tran, "bp.invalidArguments", "required patterns parameter missing");
+        return;
+    }
+    std::vector<std::string> patterns;
+    for (unsigned int i = 0; i < patternList->size(); i++) {
+        const bplus::String* s = dynamic_cast<const bplus::String*>(patternList->value(i));
+        if (s && !s->value().empty()) {
+            patterns.push_back(s->value());
+        }
+    }
+    if (patterns.empty()) {
+        fail(tran, "bp.invalidArguments", "no non-empty patterns given");
+        return;
+    }
+    bool ignoreCase = false;
+    boolArg(args, "ignoreCase", ignoreCase);
+    long long max = kDefaultGrepMatches;
+    integerArg(args, "maxMatches", max);
+    if (max <= 0 || max > kMaxGrepMatches) {
+        max = kMaxGrepMatches;
+    }
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    // every file is searched in parallel up to the limit, the results
+    // are then trimmed to the limit in file order
+    logaccess::LineSearcher searcher(patterns, ignoreCase);
+    std::vector<GrepResult> found(files.size());
+    logaccess::pool::parallelFor(files.size(),
+                                 boost::bind(&LogAccess::grepFile, boost::cref(searcher),
+                                             (std::size_t) max, boost::cref(files),
+                                             boost::ref(found), _1));
+    bplus::List* matches = new bplus::List;
+    bool truncated = false;
+    long long count = 0;
+    for (unsigned int i = 0; i < files.size(); i++) {
+        const GrepResult& r = found[i];
+        if (!r.error.empty()) {
+            delete matches;
+            fail(tran, "bp.couldntGetLogs", r.error.c_str());
+            return;
+        }
+        truncated = truncated || !r.complete;
+        for (std::vector<logaccess::SearchMatch>::const_iterator it = r.matches.begin(); it != r.matches.end(); ++it) {
+            if (count >= max) {
+                truncated = true;
+                break;
+            }
+            bplus::Map* m = new bplus::Map;
+            m->add("path", new bplus::Path(bp::file::nativeString(files[i])));
+            m->add("line", new bplus::Integer(it->line));
+            m->add("offset", new bplus::Integer(it->offset));
+            m->add("text", new bplus::String(it->text));
+            matches->append(m);
+            count++;
+        }
+    }
+    bplus::Map results;
+    results.add("matches", matches);
+    results.add("truncated", new bplus::Bool(truncated));
+    tran.complete(results);
+}
+
+void
+LogAccess::grepFile(const logaccess::LineSearcher& searcher, std::size_t max,
+                    const std::vector<boost::filesystem::path>& files,
+                    std::vector<GrepResult>& results, unsigned int i) {
+    GrepResult& r = results[i];
+    // read rather than mapped, a log truncated under a mapping would
+    // take the process down
+    logaccess::File file;
+    boost::uint64_t size = 0;
+    if (!file.open(files[i]) || !file.size(size)) {
+        r.error = std::string("unable to read ") + files[i].string();
+        return;
+    }
+    logaccess::LineBlockReader blocks(file, 0, size, kGrepBlock);
+    const char* data;
+    std::size_t len;
+    boost::uint64_t offset;
+    boost::uint64_t line = 1;
+    while (r.complete && blocks.next(data, len, offset)) {
+        r.complete = searcher.search(data, len, offset, line, max, r.matches);
+    }
+    if (blocks.failed()) {
+        r.error = std::string("unable to read ") + files[i].string();
+    }
+}
+
+// follow threads running, shared by all instances
+static boost::mutex s_followsLock;
+static unsigned int s_follows = 0;
+
+// One of the kMaxFollows places a follow runs in, given back when the
+// holder goes away.  follow() holds it until the follow's thread is
+// running and handOff()s it, the thread adopt()s it.
+class FollowSlot : boost::noncopyable {
+public:
+    FollowSlot() : m_held(false) {}
+
+    ~FollowSlot() {
+        if (m_held) {
+            boost::mutex::scoped_lock lock(s_followsLock);
+            s_follows--;
+        }
+    }
+
+    // false if every place is taken
+    bool acquire() {
+        boost::mutex::scoped_lock lock(s_followsLock);
+        if (s_follows >= kMaxFollows) {
+            return false;
+        }
+        s_follows++;
+        m_held = true;
+        return true;
+    }
+
+    void handOff() { m_held = false; }
+    void adopt() { m_held = true; }
+
+private:
+    bool m_held;
+};
+
+void
+LogAccess::follow(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kFollow);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    const bplus::Object* callback = args.value("callback");
+    if (!callback) {
+        fail(tran, "bp.invalidArguments", "required callback parameter missing");
+        return;
+    }
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    std::vector<boost::uint64_t> offsets(files.size(), logaccess::Follower::kFromEnd);
+    const bplus::List* offsetList = NULL;
+    if (args.getList("offsets", offsetList)) {
+        for (unsigned int i = 0; i < offsetList->size() && i < offsets.size(); i++) {
+            const bplus::Integer* o = dynamic_cast<const bplus::Integer*>(offsetList->value(i));
+            if (o && o->value() >= 0) {
+                offsets[i] = o->value();
+            }
+        }
+    }
+    long long intervalMs = boundedArg(args, "interval", kDefaultFollowIntervalMs, kMaxFollowIntervalMs);
+    long long maxBatch = boundedArg(args, "maxBatch", kDefaultFollowBatch, kMaxFollowBatch);
+    long long seconds = boundedArg(args, "duration", kDefaultFollowSeconds, kMaxFollowSeconds);
+    FollowSlot slot;
+    if (!slot.acquire()) {
+        fail(tran, "bp.busy", "too many follows in progress, try again later");
+        return;
+    }
+
+    boost::shared_ptr<bplus::service::Callback> cb(new bplus::service::Callback(tran, *callback));
+    FollowJob job;
+    job.follower.reset(new logaccess::Follower(files, offsets, (unsigned int) intervalMs,
+                                               (std::size_t) maxBatch,
+                                               boost::bind(&LogAccess::sendChunks, cb, _1)));
+    boost::mutex::scoped_lock lock(m_followLock);
+    // reap follows that have finished
+    for (std::vector<FollowJob>::iterator it = m_follows.begin(); it != m_follows.end(); ) {
+        if (it->follower->done()) {
+            it->thread->join();
+            it = m_follows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    job.thread.reset(new boost::thread(boost::bind(&LogAccess::runFollower, job.follower,
+                                                   tran, (unsigned int) (seconds * 1000))));
+    slot.handOff();
+    m_follows.push_back(job);
+}
+
+void
+LogAccess::runFollower(boost::shared_ptr<logaccess::Follower> follower,
+                       bplus::service::Transaction tran, unsigned int durationMs) {
+    FollowSlot slot;
+    slot.adopt();
+    logaccess::stats::Attach attach(logaccess::stats::kFollow);
+    follower->run(durationMs);
+    std::vector<boost::uint64_t> offsets = follower->offsets();
+    bplus::List results;
+    for (unsigned int i = 0; i < offsets.size(); i++) {
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(follower->files()[i])));
+        m->add("offset", new bplus::Integer(offsets[i]));
+        results.append(m);
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::sendChunks(boost::shared_ptr<bplus::service::Callback> cb,
+                      const std::vector<logaccess::FollowChunk>& chunks) {
+    bplus::List batch;
+    for (std::vector<logaccess::FollowChunk>::const_iterator it = chunks.begin(); it != chunks.end(); ++it) {
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(it->path)));
+        m->add("offset", new bplus::Integer(it->offset));
+        m->add("data", new bplus::String(it->data));
+        m->add("reset", new bplus::Bool(it->reset));
+        batch.append(m);
+    }
+    cb->invoke(batch);
+}
+
+void
+LogAccess::getBundle(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kGetBundle);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    // platform logs go under platform/, service logs under services/<name>/
+    std::vector<logaccess::BundleEntry> entries;
+    bplus::List paths;
+    std::string error = m_lookups->cache().getLogfilePaths(paths);
+    if (!error.empty()) {
+        fail(tran, "bp.couldntGetLogs", error.c_str());
+        return;
+    }
+    std::vector<std::string> dirs(paths.size(), "platform/");
+    const bplus::List* serviceList = NULL;
+    if (args.getList("services", serviceList)) {
+        std::set<std::string> seen;
+        for (unsigned int i = 0; i < serviceList->size(); i++) {
+            const bplus::String* s = dynamic_cast<const bplus::String*>(serviceList->value(i));
+            if (!s || !seen.insert(s->value()).second) {
+                continue;
+            }
+            error = m_lookups->cache().getServiceLogfilePaths(s->value(), paths);
             if (!error.empty()) {
-                tran.error("bp.couldntGetLogs", error.c_str());
+                fail(tran, "bp.couldntGetLogs", error.c_str());
                 return;
             }
+            dirs.resize(paths.size(), "services/" + s->value() + "/");
+        }
+    }
+    for (unsigned int i = 0; i < paths.size(); i++) {
+        const bplus::Path* p = dynamic_cast<const bplus::Path*>(paths.value(i));
+        if (p) {
+            logaccess::BundleEntry entry;
+            entry.file = boost::filesystem::path(p->value());
+            entry.name = dirs[i] + entry.file.filename().string();
+            entries.push_back(entry);
+        }
+    }
+    boost::filesystem::path dir(tempDir());
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(dir, ec);
+    std::stringstream ss;
+    {
+        boost::mutex::scoped_lock lock(m_bundleLock);
+        ss << "LogAccessBundle-" << std::time(NULL) << "-" << m_bundles++ << ".zip";
+    }
+    boost::filesystem::path out = dir / ss.str();
+    logaccess::BundleStats stats;
+    error = logaccess::writeBundle(entries, out, stats);
+    if (!error.empty()) {
+        fail(tran, "bp.couldntGetLogs", error.c_str());
+        return;
+    }
+    {
+        boost::mutex::scoped_lock lock(m_bundleLock);
+        if (!m_lastBundle.empty()) {
+            boost::filesystem::remove(m_lastBundle, ec);
+        }
+        m_lastBundle = out;
+    }
+    bplus::Map results;
+    results.add("bundle", new bplus::Path(bp::file::nativeString(out)));
+    results.add("files", new bplus::Integer(stats.files));
+    results.add("originalSize", new bplus::Integer(stats.originalSize));
+    results.add("compressedSize", new bplus::Integer(stats.compressedSize));
+    results.add("ratio", new bplus::Double(stats.compressedSize > 0
+                                           ? (double) stats.originalSize / stats.compressedSize
+                                           : 0.0));
+    results.add("elapsedMs", new bplus::Integer(stats.elapsedMs));
+    tran.complete(results);
+}
+
+void
+LogAccess::range(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kRange);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    std::string start, end;
+    boost::int64_t from = 0, to = 0;
+    if (!stringArg(args, "start", start) || !logaccess::parseTimestamp(start, from)
+        || !stringArg(args, "end", end) || !logaccess::parseTimestamp(end, to)) {
+        fail(tran, "bp.invalidArguments", "start and end must be \"YYYY-MM-DD HH:MM:SS\" times");
+        return;
+    }
+    long long maxBytes = boundedArg(args, "maxBytes", kDefaultRangeBytes, kMaxRangeBytes);
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    bplus::List results;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        logaccess::RangeResult rr;
+        std::string error = m_indexes.range(*it, from, to, (std::size_t) maxBytes, rr);
+        if (!error.empty()) {
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(*it)));
+        m->add("offset", new bplus::Integer(rr.offset));
+        m->add("data", new bplus::String(rr.data));
+        m->add("truncated", new bplus::Bool(rr.truncated));
+        results.append(m);
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::query(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kQuery);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    logaccess::ColumnQuery q;
+    std::string s;
+    if (stringArg(args, "minLevel", s)) {
+        q.minLevel = logaccess::parseLevel(s.data(), s.size());
+        if (q.minLevel == logaccess::kLevelUnknown) {
+            fail(tran, "bp.invalidArguments", "unknown minLevel");
+            return;
+        }
+    }
+    if ((stringArg(args, "start", s) && !logaccess::parseTimestamp(s, q.from))
+        || (stringArg(args, "end", s) && !logaccess::parseTimestamp(s, q.to))) {
+        fail(tran, "bp.invalidArguments", "start and end must be \"YYYY-MM-DD HH:MM:SS\" times");
+        return;
+    }
+    stringSetArg(args, "categories", q.categories);
+    stringSetArg(args, "threads", q.threads);
+    bool countOnly = false;
+    boolArg(args, "countOnly", countOnly);
+    long long limit = countOnly ? 0 : boundedArg(args, "limit", kDefaultQueryLines, kMaxQueryLines);
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    m_columns.setDir(boost::filesystem::path(dataDir()) / "columns");
+    boost::uint64_t total = 0;
+    bplus::List* lines = new bplus::List;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        std::vector<logaccess::ColumnMatch> matches;
+        boost::uint64_t count = 0;
+        std::size_t room = (std::size_t) (limit > (long long) lines->size() ? limit - lines->size() : 0);
+        std::string error = m_columns.query(*it, q, room, matches, count);
+        if (!error.empty()) {
+            delete lines;
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        total += count;
+        for (std::vector<logaccess::ColumnMatch>::const_iterator m = matches.begin(); m != matches.end(); ++m) {
+            bplus::Map* line = new bplus::Map;
+            line->add("path", new bplus::Path(bp::file::nativeString(*it)));
+            line->add("offset", new bplus::Integer(m->offset));
+            line->add("time", new bplus::Integer(m->time));
+            line->add("level", new bplus::String(logaccess::levelName(m->level)));
+            line->add("thread", new bplus::String(m->thread));
+            line->add("category", new bplus::String(m->category));
+            line->add("message", new bplus::String(m->message));
+            lines->append(line);
+        }
+    }
+    bplus::Map results;
+    results.add("count", new bplus::Integer(total));
+    if (countOnly) {
+        delete lines;
+    } else {
+        results.add("lines", lines);
+    }
+    tran.complete(results);
+}
+
+static bplus::Map*
+timelineLineToMap(const boost::filesystem::path& path, const logaccess::TimelineLine& line) {
+    bplus::Map* m = new bplus::Map;
+    m->add("path", new bplus::Path(bp::file::nativeString(path)));
+    m->add("offset", new bplus::Integer(line.offset));
+    if (line.time != logaccess::Timeline::kNoTime) {
+        m->add("time", new bplus::Integer(line.time));
+    }
+    m->add("text", new bplus::String(line.text));
+    return m;
+}
+
+void
+LogAccess::timeline(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kTimeline);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    boost::int64_t from = logaccess::Timeline::kNoTime;
+    boost::int64_t to = std::numeric_limits<boost::int64_t>::max();
+    std::string start, end;
+    if ((stringArg(args, "start", start) && !logaccess::parseTimestamp(start, from))
+        || (stringArg(args, "end", end) && !logaccess::parseTimestamp(end, to))) {
+        fail(tran, "bp.invalidArguments", "start and end must be \"YYYY-MM-DD HH:MM:SS\" times");
+        return;
+    }
+    long long limit = boundedArg(args, "limit", kDefaultTimelineLines, kMaxTimelineLines);
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    // each log's rotated copies go in just ahead of it, oldest first
+    std::vector<boost::filesystem::path> merged;
+    std::vector<bool> rotated;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        std::string error = logaccess::util::listRotated(*it, merged);
+        if (!error.empty()) {
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        rotated.resize(merged.size(), true);
+        merged.push_back(*it);
+        rotated.push_back(false);
+    }
+    logaccess::Timeline timeline;
+    std::vector<boost::filesystem::path> sources;
+    for (unsigned int i = 0; i < merged.size(); i++) {
+        // the time index saves reading everything logged before the window
+        boost::uint64_t offset = 0;
+        if (from != logaccess::Timeline::kNoTime) {
+            logaccess::File file;
+            if (file.open(merged[i])) {
+                m_indexes.seek(merged[i], file, from, offset);
+            }
         }
+        if (timeline.add(merged[i], offset)) {
+            sources.push_back(merged[i]);
+        } else if (!rotated[i]) {
+            // a rotated copy may have rotated away since it was listed
+            fail(tran, "bp.couldntGetLogs", ("unable to open " + merged[i].string()).c_str());
+            return;
+        }
+    }
+    boost::scoped_ptr<bplus::service::Callback> cb;
+    const bplus::Object* callback = args.value("callback");
+    if (callback) {
+        cb.reset(new bplus::service::Callback(tran, *callback));
+    }
+    // without a callback lines go straight into the result, with one
+    // they're gathered into batches
+    bplus::Map results;
+    bplus::List* lines = NULL;
+    boost::scoped_ptr<bplus::List> batch;
+    if (cb) {
+        batch.reset(new bplus::List);
+        lines = batch.get();
+    } else {
+        lines = new bplus::List;
+        results.add("lines", lines);
+    }
+    long long count = 0;
+    bool truncated = false;
+    logaccess::TimelineLine line;
+    while (timeline.next(line)) {
+        if (line.time < from) {
+            continue;
+        }
+        if (line.time > to) {
+            break;
+        }
+        if (count == limit) {
+            truncated = true;
+            break;
+        }
+        lines->append(timelineLineToMap(sources[line.file], line));
+        count++;
+        if (cb && batch->size() >= kTimelineBatch) {
+            cb->invoke(*batch);
+            batch.reset(new bplus::List);
+            lines = batch.get();
+        }
+    }
+    if (!timeline.failed().empty()) {
+        fail(tran, "bp.couldntGetLogs", ("unable to read " + timeline.failed().string()).c_str());
+        return;
+    }
+    if (cb && batch->size() > 0) {
+        cb->invoke(*batch);
+    }
+    results.add("count", new bplus::Integer(count));
+    results.add("truncated", new bplus::Bool(truncated));
+    tran.complete(results);
+}
+
+void
+LogAccess::summary(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kSummary);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    long long top = boundedArg(args, "top", kDefaultSummaryTop, kMaxSummaryTop);
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    bplus::List results;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        logaccess::LogSummary summary;
+        std::string error = logaccess::summarize(*it, (std::size_t) top, summary);
+        if (!error.empty()) {
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(*it)));
+        m->add("size", new bplus::Integer(summary.size));
+        m->add("lines", new bplus::Integer(summary.lines));
+        bplus::Map* levels = new bplus::Map;
+        for (int l = 0; l < logaccess::kNumLevels; l++) {
+            levels->add(logaccess::levelName((logaccess::LogLevel) l),
+                        new bplus::Integer(summary.levels[l]));
+        }
+        m->add("levels", levels);
+        if (summary.haveTimes) {
+            m->add("first", new bplus::Integer(summary.first));
+            m->add("last", new bplus::Integer(summary.last));
+        }
+        bplus::List* messages = new bplus::List;
+        for (std::vector<logaccess::MessageCount>::const_iterator mc = summary.top.begin();
+             mc != summary.top.end(); ++mc) {
+            bplus::Map* msg = new bplus::Map;
+            msg->add("message", new bplus::String(mc->message));
+            msg->add("count", new bplus::Integer(mc->count));
+            messages->append(msg);
+        }
+        m->add("distinct", new bplus::Integer(summary.distinct));
+        m->add("top", messages);
+        results.append(m);
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::diagnose(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kDiagnose);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    boost::shared_ptr<const logaccess::Signatures> signatures =
+        sharedSignatures(boost::filesystem::path(serviceDir()));
+    std::vector<DiagnoseResult> found(files.size());
+    logaccess::pool::parallelFor(files.size(),
+                                 boost::bind(&LogAccess::diagnoseFile, boost::cref(*signatures),
+                                             boost::cref(files), boost::ref(found), _1));
+    bplus::List results;
+    for (unsigned int i = 0; i < files.size(); i++) {
+        if (!found[i].error.empty()) {
+            fail(tran, "bp.couldntGetLogs", found[i].error.c_str());
+            return;
+        }
+        bplus::List* hits = new bplus::List;
+        for (std::vector<logaccess::SignatureHit>::const_iterator it = found[i].hits.begin();
+             it != found[i].hits.end(); ++it) {
+            bplus::Map* h = new bplus::Map;
+            h->add("id", new bplus::String(signatures->id(it->signature)));
+            h->add("count", new bplus::Integer(it->count));
+            h->add("first", new bplus::Integer(it->first));
+            h->add("last", new bplus::Integer(it->last));
+            hits->append(h);
+        }
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(files[i])));
+        m->add("signatures", hits);
+        results.append(m);
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::diagnoseFile(const logaccess::Signatures& signatures,
+                        const std::vector<boost::filesystem::path>& files,
+                        std::vector<DiagnoseResult>& results, unsigned int i) {
+    results[i].error = signatures.scan(files[i], results[i].hits);
+}
+
+void
+LogAccess::manifest(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kManifest);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    bplus::List results;
+    for (std::vector<boost::filesystem::path>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        logaccess::Manifest manifest;
+        std::string error = m_chunks.manifest(*it, manifest);
+        if (!error.empty()) {
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        bplus::List* chunks = new bplus::List;
+        for (std::vector<logaccess::Chunk>::const_iterator c = manifest.chunks.begin();
+             c != manifest.chunks.end(); ++c) {
+            bplus::Map* chunk = new bplus::Map;
+            chunk->add("offset", new bplus::Integer(c->offset));
+            chunk->add("length", new bplus::Integer(c->length));
+            chunk->add("digest", new bplus::String(c->digest));
+            chunks->append(chunk);
+        }
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(*it)));
+        m->add("size", new bplus::Integer(manifest.size));
+        m->add("modified", new bplus::Integer(manifest.modified));
+        m->add("chunks", chunks);
+        results.append(m);
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::fetchChunks(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kFetchChunks);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    std::set<std::string> have;
+    stringSetArg(args, "have", have);
+    long long maxBytes = boundedArg(args, "maxBytes", kDefaultFetchBytes, kMaxFetchBytes);
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    std::vector<logaccess::FetchedChunk> fetched;
+    std::vector<std::size_t> fileOf;
+    bool truncated = false;
+    for (std::size_t i = 0; i < files.size() && !truncated; i++) {
+        std::string error = m_chunks.fetch(files[i], have, (std::size_t) maxBytes,
+                                           fetched, truncated);
+        if (!error.empty()) {
+            fail(tran, "bp.couldntGetLogs", error.c_str());
+            return;
+        }
+        fileOf.resize(fetched.size(), i);
+    }
+    bplus::List* chunks = new bplus::List;
+    for (std::size_t i = 0; i < fetched.size(); i++) {
+        const logaccess::FetchedChunk& f = fetched[i];
+        bplus::Map* m = new bplus::Map;
+        m->add("path", new bplus::Path(bp::file::nativeString(files[fileOf[i]])));
+        m->add("offset", new bplus::Integer(f.chunk.offset));
+        m->add("length", new bplus::Integer(f.chunk.length));
+        m->add("digest", new bplus::String(f.chunk.digest));
+        m->add("data", new bplus::String(f.data));
+        chunks->append(m);
+    }
+    bplus::Map results;
+    results.add("chunks", chunks);
+    results.add("truncated", new bplus::Bool(truncated));
+    tran.complete(results);
+}
+
+// the reader all read transactions share, so that together they hold
+// at most kMaxReads * kMaxReadBytes
+static logaccess::ChunkReader s_reader(kMaxReadBytes, kMaxReads);
+
+void
+LogAccess::read(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kRead);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    const bplus::Path* file = dynamic_cast<const bplus::Path*>(args.value("file"));
+    if (!file) {
+        fail(tran, "bp.invalidArguments", "required file parameter missing");
+        return;
+    }
+    long long offset = 0;
+    integerArg(args, "offset", offset);
+    if (offset < 0) {
+        fail(tran, "bp.invalidArguments", "offset must not be negative");
+        return;
+    }
+    long long maxBytes = boundedArg(args, "maxBytes", kDefaultReadBytes, kMaxReadBytes);
+    // no "files" given, so these are all the logs that may be read
+    std::vector<boost::filesystem::path> files;
+    if (!selectLogFiles(tran, args, files)) {
+        return;
+    }
+    boost::filesystem::path path(file->value());
+    if (std::find(files.begin(), files.end(), path) == files.end()) {
+        // only logfiles may be read thru this service
+        fail(tran, "bp.permissionDenied", "not a BrowserPlus logfile");
+        return;
+    }
+    logaccess::ReadChunk chunk;
+    bool busy = false;
+    std::string error = s_reader.read(path, (boost::uint64_t) offset, (std::size_t) maxBytes,
+                                      chunk, busy);
+    if (!error.empty()) {
+        fail(tran, busy ? "bp.busy" : "bp.couldntGetLogs", error.c_str());
+        return;
+    }
+    bplus::Map results;
+    results.add("data", new bplus::String(chunk.data));
+    results.add("offset", new bplus::Integer(chunk.offset));
+    results.add("next", new bplus::Integer(chunk.next));
+    results.add("eof", new bplus::Bool(chunk.eof));
+    tran.complete(results);
+}
+
+static bplus::Map*
+totalsToMap(const logaccess::stats::Totals& t) {
+    bplus::Map* m = new bplus::Map;
+    m->add("calls", new bplus::Integer(t.calls));
+    m->add("timeUs", new bplus::Integer(t.timeUs));
+    m->add("p50Us", new bplus::Integer(logaccess::stats::percentileUs(t, 0.5)));
+    m->add("p90Us", new bplus::Integer(logaccess::stats::percentileUs(t, 0.9)));
+    m->add("p99Us", new bplus::Integer(logaccess::stats::percentileUs(t, 0.99)));
+    bplus::List* latency = new bplus::List;
+    for (unsigned int b = 0; b < logaccess::stats::kNumBuckets; b++) {
+        if (t.buckets[b] == 0) {
+            continue;
+        }
+        bplus::Map* bucket = new bplus::Map;
+        bucket->add("underUs", new bplus::Integer(1LL << b));
+        bucket->add("count", new bplus::Integer(t.buckets[b]));
+        latency->append(bucket);
+    }
+    m->add("latency", latency);
+    for (unsigned int c = 0; c < logaccess::stats::kNumCounters; c++) {
+        m->add(logaccess::stats::counterName((logaccess::stats::Counter) c),
+               new bplus::Integer(t.counters[c]));
+    }
+    bplus::Map* errors = new bplus::Map;
+    for (unsigned int e = 0; e < logaccess::stats::kNumErrors; e++) {
+        if (t.errors[e] > 0) {
+            errors->add(logaccess::stats::errorName((logaccess::stats::Error) e),
+                        new bplus::Integer(t.errors[e]));
+        }
+    }
+    m->add("errors", errors);
+    return m;
+}
+
+void
+LogAccess::stats(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kStats);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
+    }
+    std::vector<logaccess::stats::Totals> totals;
+    logaccess::stats::totals(totals);
+    bplus::Map results;
+    for (unsigned int i = 0; i < logaccess::stats::kNumMethods; i++) {
+        const logaccess::stats::Totals& t = totals[i];
+        bool idle = (t.calls == 0);
+        for (unsigned int c = 0; idle && c < logaccess::stats::kNumCounters; c++) {
+            idle = (t.counters[c] == 0);
+        }
+        if (!idle) {
+            results.add(logaccess::stats::methodName((logaccess::stats::Method) i), totalsToMap(t));
+        }
+    }
+    tran.complete(results);
+}
+
+void
+LogAccess::resetStats(const bplus::service::Transaction& tran, const bplus::Map& args) {
+    logaccess::stats::Call call(logaccess::stats::kStats);
+    if (!allowed()) {
+        fail(tran, "bp.permissionDenied", NULL);
+        return;
     }
-    tran.complete(paths);
+    logaccess::stats::reset();
+    tran.complete(bplus::Bool(true));
 }
@@ -10,8 +10,62 @@ include Config
 require 'webrick'
 include WEBrick
 require 'pp'
+require 'tmpdir'
+require 'fileutils'
+require 'digest/sha1'
 
 class TestLogAccess < Test::Unit::TestCase
+  # platform logs with known times, levels, messages and failures
+  FIXTURE_LOGS = {
+    'BrowserPlusCore.log' =>
+      "2010-06-01 10:00:00 INFO [1] core.cpp:10 - started\n" +
+      "2010-06-01 10:00:02 WARN [1] core.cpp:20 - request 17 timed out\n" +
+      "2010-06-01 10:00:04 ERROR [2] core.cpp:30 - Segmentation fault in worker 3\n" +
+      "2010-06-01 10:00:06 INFO [1] core.cpp:10 - request 18 took 5ms\n" +
+      "2010-06-01 10:00:08 INFO [1] core.cpp:10 - request 20 took 41ms\n" +
+      "2010-06-01 10:00:10 FATAL [2] core.cpp:31 - worker 4 got SIGSEGV\n",
+    'bpnpapi.log' =>
+      "2010-06-01 10:00:01 DEBUG [7] npapi.cpp:5 - plugin loaded\n" +
+      "2010-06-01 10:00:03 INFO [7] npapi.cpp:9 - request 19 took 12ms\n" +
+      "2010-06-01 10:00:05 ERROR [7] npapi.cpp:9 - write failed: No space left on device\n"
+  }
+
+  # run the block with the service finding its logs (a map of name to
+  # contents) in a scratch XDG data dir rather than the user's.  services
+  # maps a service name to the logs of its major version 1.  only linux
+  # finds its logs through XDG_DATA_HOME, on windows and os x the block
+  # isn't run and tests built on fixtures check nothing.
+  def with_fixture_logs(logs = FIXTURE_LOGS, services = {})
+    return unless RUBY_PLATFORM =~ /linux/
+    Dir.mktmpdir { |home|
+      bp = File.join(home, 'Yahoo!', 'BrowserPlus')
+      dir = File.join(bp, '2.9.0', 'fixture')
+      FileUtils.mkdir_p(dir)
+      logs.each { |name, data|
+        File.open(File.join(dir, name), 'wb') { |f| f.write(data) }
+      }
+      services.each { |service, files|
+        sdir = File.join(bp, 'CoreletData', service, '1')
+        FileUtils.mkdir_p(sdir)
+        files.each { |name, data|
+          File.open(File.join(sdir, name), 'wb') { |f| f.write(data) }
+        }
+      }
+      saved = ENV['XDG_DATA_HOME']
+      ENV['XDG_DATA_HOME'] = home
+      begin
+        yield dir
+      ensure
+        ENV['XDG_DATA_HOME'] = saved
+      end
+    }
+  end
+
+  # a "YYYY-MM-DD HH:MM:SS" log time as the service reports it
+  def log_ms(s)
+    Time.utc(*s.split(/[- :]/).map { |n| n.to_i }).to_i * 1000
+  end
+
   def setup
     subdir = 'build/LogAccess'
     if ENV.key?('BP_OUTPUT_DIR')
@@ -90,9 +144,475 @@ class TestLogAccess < Test::Unit::TestCase
     }
   end
 
+  # BrowserPlus.LogAccess.getServiceLogs({params}, function{}())
+  # Returns a map keyed by service name of files or errors.
+  def test_getServiceLogs_missing_service
+    BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+      x = s.getServiceLogs({ 'services' => [ 'NoSuchService', 'NoSuchService' ] })
+      assert_equal([ 'NoSuchService' ], x.keys)
+      assert_equal([], x['NoSuchService']['files'])
+    }
+  end
+
+  # BrowserPlus.LogAccess.tail({params}, function{}())
+  # Returns the last lines of each logfile.
+  # a map of service to its files, or to an error when its data dir
+  # holds no logs
+  def test_getServiceLogs_shape
+    services = {
+      'FixtureService' => { 'svc.log' => "hello\n", 'svc2.log' => "again\n" },
+      'BrokenService' => { 'notes.txt' => "no logs here\n" }
+    }
+    with_fixture_logs(FIXTURE_LOGS, services) { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        x = s.getServiceLogs({ 'services' => [ 'FixtureService', 'NoSuchService', 'BrokenService' ] })
+        assert_equal([ 'BrokenService', 'FixtureService', 'NoSuchService' ], x.keys.sort)
+        assert_equal([ 'files' ], x['FixtureService'].keys)
+        assert_equal([ 'svc.log', 'svc2.log' ],
+                     x['FixtureService']['files'].map { |p| File.basename(p) }.sort)
+        assert_equal({ 'files' => [] }, x['NoSuchService'])
+        assert_equal([ 'error' ], x['BrokenService'].keys)
+        assert_kind_of(String, x['BrokenService']['error'])
+
+        x = s.getServiceLogs({ 'services' => [ 'FixtureService' ], 'details' => true })
+        got = x['FixtureService']['files'].map { |f|
+          [ File.basename(f['path']), f['size'], f['lines'], f['component'] ]
+        }
+        assert_equal([ [ 'svc.log', 6, 1, 'FixtureService/1' ],
+                       [ 'svc2.log', 6, 1, 'FixtureService/1' ] ], got.sort)
+      }
+    }
+  end
+
+  def test_tail_lines
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        got = {}
+        s.tail({ 'lines' => 2 }).each { |f|
+          got[File.basename(f['path'])] = [ f['size'], f['offset'], f['data'] ]
+        }
+        core = FIXTURE_LOGS['BrowserPlusCore.log']
+        npapi = FIXTURE_LOGS['bpnpapi.log']
+        assert_equal({ 'BrowserPlusCore.log' => [ 382, 253, core[253..-1] ],
+                       'bpnpapi.log' => [ 204, 58, npapi[58..-1] ] }, got)
+        # bytes cuts mid line
+        path = s.get().find { |p| File.basename(p) == 'bpnpapi.log' }
+        x = s.tail({ 'bytes' => 70, 'files' => [ path ] })
+        assert_equal(1, x.size)
+        assert_equal(134, x[0]['offset'])
+        assert_equal(npapi[134..-1], x[0]['data'])
+      }
+    }
+  end
+
+  def test_grep_case
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        x = s.grep({ 'patterns' => [ 'info' ], 'ignoreCase' => true })
+        assert_equal(false, x['truncated'])
+        got = x['matches'].map { |m| [ File.basename(m['path']), m['line'], m['offset'], m['text'] ] }
+        core = FIXTURE_LOGS['BrowserPlusCore.log'].split("\n")
+        npapi = FIXTURE_LOGS['bpnpapi.log'].split("\n")
+        assert_equal([ [ 'BrowserPlusCore.log', 1, 0, core[0] ],
+                       [ 'BrowserPlusCore.log', 4, 190, core[3] ],
+                       [ 'BrowserPlusCore.log', 5, 253, core[4] ],
+                       [ 'bpnpapi.log', 2, 58, npapi[1] ] ], got.sort)
+        x = s.grep({ 'patterns' => [ 'info' ] })
+        assert_equal([], x['matches'])
+        x = s.grep({ 'patterns' => [ 'INFO', 'SIGSEGV' ], 'maxMatches' => 2 })
+        assert_equal(2, x['matches'].size)
+        assert_equal(true, x['truncated'])
+      }
+    }
+  end
+
+  # appended lines, then a rotated log's replacement, then the same log
+  # truncated, each come through the callback
+  def test_follow_rotate_truncate
+    with_fixture_logs(FIXTURE_LOGS.merge({ 'follow.log' => "x\n" })) { |dir|
+      log = File.join(dir, 'follow.log')
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        path = s.get().find { |p| File.basename(p) == 'follow.log' }
+        writer = Thread.new {
+          sleep 0.5
+          File.open(log, 'ab') { |f| f.write("a\n") }
+          sleep 0.7
+          File.rename(log, log + '.1')
+          File.open(log, 'wb') { |f| f.write("bb bb\n") }
+          sleep 0.7
+          File.open(log, 'wb') { |f| f.write("c\n") }
+        }
+        got = []
+        x = s.follow({ 'files' => [ path ], 'interval' => 100, 'duration' => 3,
+                       'callback' => lambda { |batch|
+                         batch.each { |c| got << [ File.basename(c['path']), c['offset'], c['data'], c['reset'] ] }
+                       } })
+        writer.join
+        assert_equal([ [ 'follow.log', 2, "a\n", false ],
+                       [ 'follow.log', 0, "bb bb\n", true ],
+                       [ 'follow.log', 0, "c\n", true ] ], got)
+        assert_equal(1, x.size)
+        assert_equal(2, x[0]['offset'])
+      }
+    }
+  end
+
+  def test_getBundle
+    BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+      x = s.getBundle({})
+      assert(File.exist?(x['bundle']))
+      assert_equal(File.size(x['bundle']), x['compressedSize'])
+      assert_equal(s.get().size, x['files'])
+      # only the latest bundle is kept, and no part files are left over
+      y = s.getBundle({})
+      assert(!File.exist?(x['bundle']))
+      assert(File.exist?(y['bundle']))
+      assert_equal([], Dir.glob(File.join(File.dirname(y['bundle']), '*.part')))
+    }
+  end
+
+  # BrowserPlus.LogAccess.range({params}, function{}())
+  # Returns the lines logged in a time window.
+  def test_range_bad_time
+    BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+      assert_raise(RuntimeError) {
+        s.range({ 'start' => 'yesterday', 'end' => '2010-01-01 00:00:00' })
+      }
+    }
+  end
+
+  # BrowserPlus.LogAccess.query({params}, function{}())
+  # Returns the log lines matching level, category and thread filters.
+  def test_range_window
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        got = {}
+        s.range({ 'start' => '2010-06-01 10:00:02', 'end' => '2010-06-01 10:00:05' }).each { |f|
+          got[File.basename(f['path'])] = [ f['offset'], f['data'], f['truncated'] ]
+        }
+        core = FIXTURE_LOGS['BrowserPlusCore.log']
+        npapi = FIXTURE_LOGS['bpnpapi.log']
+        assert_equal({ 'BrowserPlusCore.log' => [ 51, core[51...190], false ],
+                       'bpnpapi.log' => [ 58, npapi[58..-1], false ] }, got)
+        # the second line won't fit, the first is all there is
+        x = s.range({ 'start' => '2010-06-01 10:00:02', 'end' => '2010-06-01 10:00:05',
+                      'maxBytes' => 100 })
+        x = x.find { |f| File.basename(f['path']) == 'BrowserPlusCore.log' }
+        assert_equal([ 51, core[51...115], true ], [ x['offset'], x['data'], x['truncated'] ])
+      }
+    }
+  end
+
+  # the index follows the log as it grows past several strides, and
+  # starts over when it's rotated
+  def test_range_grows_and_rotates
+    line = lambda { |h, i| "2010-06-01 %02d:%02d:%02d INFO [5] grow.cpp:1 - line %d\n" % [ h, i / 60, i % 60, i ] }
+    first = (0...3000).map { |i| line.call(12, i) }
+    with_fixture_logs(FIXTURE_LOGS.merge({ 'grow.log' => first.join })) { |dir|
+      log = File.join(dir, 'grow.log')
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        path = s.get().find { |p| File.basename(p) == 'grow.log' }
+        x = s.range({ 'start' => '2010-06-01 12:49:00', 'end' => '2010-06-01 12:49:59',
+                      'files' => [ path ] })[0]
+        assert_equal(first[0...2940].join.size, x['offset'])
+        assert_equal(first[2940...3000].join, x['data'])
+
+        more = (3000...3500).map { |i| line.call(12, i) }
+        File.open(log, 'ab') { |f| f.write(more.join) }
+        x = s.range({ 'start' => '2010-06-01 12:55:00', 'end' => '2010-06-01 12:55:09',
+                      'files' => [ path ] })[0]
+        assert_equal((first + more)[0...3300].join.size, x['offset'])
+        assert_equal(more[300...310].join, x['data'])
+
+        File.rename(log, log + '.1')
+        rotated = (0...10).map { |i| line.call(13, i) }
+        File.open(log, 'wb') { |f| f.write(rotated.join) }
+        x = s.range({ 'start' => '2010-06-01 13:00:02', 'end' => '2010-06-01 13:00:04',
+                      'files' => [ path ] })[0]
+        assert_equal(rotated[0...2].join.size, x['offset'])
+        assert_equal(rotated[2...5].join, x['data'])
+        x = s.range({ 'start' => '2010-06-01 12:55:00', 'end' => '2010-06-01 12:55:09',
+                      'files' => [ path ] })[0]
+        assert_equal('', x['data'])
+      }
+    }
+  end
+
+  def test_query_level
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        assert_equal(9, s.query({ 'countOnly' => true })['count'])
+        x = s.query({ 'minLevel' => 'WARN', 'limit' => 10 })
+        assert_equal(4, x['count'])
+        got = x['lines'].map { |l|
+          [ File.basename(l['path']), l['offset'], l['time'], l['level'],
+            l['thread'], l['category'], l['message'] ]
+        }
+        assert_equal([ [ 'BrowserPlusCore.log', 51, log_ms('2010-06-01 10:00:02'), 'WARN',
+                         '1', 'core', 'request 17 timed out' ],
+                       [ 'BrowserPlusCore.log', 115, log_ms('2010-06-01 10:00:04'), 'ERROR',
+                         '2', 'core', 'Segmentation fault in worker 3' ],
+                       [ 'BrowserPlusCore.log', 317, log_ms('2010-06-01 10:00:10'), 'FATAL',
+                         '2', 'core', 'worker 4 got SIGSEGV' ],
+                       [ 'bpnpapi.log', 122, log_ms('2010-06-01 10:00:05'), 'ERROR',
+                         '7', 'npapi', 'write failed: No space left on device' ] ], got.sort)
+        x = s.query({ 'minLevel' => 'WARN', 'threads' => [ '2' ], 'limit' => 1 })
+        assert_equal(2, x['count'])
+        assert_equal(1, x['lines'].size)
+        x = s.query({ 'categories' => [ 'npapi' ], 'start' => '2010-06-01 10:00:02',
+                      'end' => '2010-06-01 10:00:04' })
+        assert_equal([ 58 ], x['lines'].map { |l| l['offset'] })
+      }
+    }
+  end
+
+  def test_timeline_ordered
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        # both logs' lines, interleaved by time
+        want = FIXTURE_LOGS.map { |name, data|
+          data.split("\n").map { |l| [ l, name, data.index(l) ] }
+        }.flatten(1).sort
+        x = s.timeline({ 'limit' => 50 })
+        assert_equal(want.size, x['count'])
+        assert_equal(false, x['truncated'])
+        got = x['lines'].map { |l| [ l['text'], File.basename(l['path']), l['offset'] ] }
+        assert_equal(want, got)
+        assert_equal(want.map { |l| log_ms(l[0][0, 19]) }, x['lines'].map { |l| l['time'] })
+
+        x = s.timeline({ 'limit' => 4, 'start' => '2010-06-01 10:00:02' })
+        assert_equal(true, x['truncated'])
+        assert_equal(want[2, 4].map { |l| l[0] }, x['lines'].map { |l| l['text'] })
+      }
+    }
+  end
+
+  def test_summary
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        x = s.summary({ 'top' => 3 })
+        assert_equal(FIXTURE_LOGS.keys.sort, x.map { |f| File.basename(f['path']) }.sort)
+        core = x.find { |f| File.basename(f['path']) == 'BrowserPlusCore.log' }
+        assert_equal(FIXTURE_LOGS['BrowserPlusCore.log'].size, core['size'])
+        assert_equal(6, core['lines'])
+        assert_equal({ 'UNKNOWN' => 0, 'DEBUG' => 0, 'INFO' => 3, 'WARN' => 1,
+                       'ERROR' => 1, 'FATAL' => 1 }, core['levels'])
+        assert_equal(log_ms('2010-06-01 10:00:00'), core['first'])
+        assert_equal(log_ms('2010-06-01 10:00:10'), core['last'])
+        assert_equal(5, core['distinct'])
+        # numbers are masked, ties go alphabetically
+        assert_equal([ [ 'request # took #ms', 2 ],
+                       [ 'Segmentation fault in worker #', 1 ],
+                       [ 'request # timed out', 1 ] ],
+                     core['top'].map { |m| [ m['message'], m['count'] ] })
+        npapi = x.find { |f| File.basename(f['path']) == 'bpnpapi.log' }
+        assert_equal(3, npapi['lines'])
+        assert_equal({ 'UNKNOWN' => 0, 'DEBUG' => 1, 'INFO' => 1, 'WARN' => 0,
+                       'ERROR' => 1, 'FATAL' => 0 }, npapi['levels'])
+      }
+    }
+  end
+
+  def test_diagnose
+    with_fixture_logs { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        core = FIXTURE_LOGS['BrowserPlusCore.log']
+        npapi = FIXTURE_LOGS['bpnpapi.log']
+        got = {}
+        s.diagnose().each { |f|
+          got[File.basename(f['path'])] =
+            f['signatures'].map { |h| [ h['id'], h['count'], h['first'], h['last'] ] }
+        }
+        # in catalog order, offsets are those of the matched text
+        assert_equal({ 'BrowserPlusCore.log' =>
+                         [ [ 'crash.segfault', 2, core.index('Segmentation fault'),
+                             core.index('SIGSEGV') ],
+                           [ 'network.timeout', 1, core.index('timed out'),
+                             core.index('timed out') ] ],
+                       'bpnpapi.log' =>
+                         [ [ 'disk.full', 1, npapi.index('No space left'),
+                             npapi.index('No space left') ] ] },
+                     got)
+      }
+    }
+  end
+
+  def test_manifest_fetch
+    big = (0...4000).map { |i|
+      "2010-06-01 11:%02d:%02d INFO [3] big.cpp:1 - line %d of the big log\n" % [ i / 60 % 60, i % 60, i ]
+    }.join
+    logs = FIXTURE_LOGS.merge({
+      'big.log' => big,
+      # FIPS 180-2 known answers, files this small are a single chunk
+      'kat.log' => 'abc',
+      'kat2.log' => 'abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq'
+    })
+    with_fixture_logs(logs) { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        files = s.manifest()
+        assert_equal(logs.keys.sort, files.map { |f| File.basename(f['path']) }.sort)
+        files.each { |f|
+          data = logs[File.basename(f['path'])]
+          assert_equal(data.size, f['size'])
+          offset = 0
+          f['chunks'].each_with_index { |c, i|
+            assert_equal(offset, c['offset'])
+            assert(c['length'] <= 65536)
+            assert(c['length'] >= 8192) if i + 1 < f['chunks'].size
+            assert_equal(Digest::SHA1.hexdigest(data[c['offset'], c['length']]), c['digest'])
+            offset += c['length']
+          }
+          assert_equal(data.size, offset)
+        }
+        digests = lambda { |name|
+          files.find { |f| File.basename(f['path']) == name }['chunks'].map { |c| c['digest'] }
+        }
+        assert_equal([ 'a9993e364706816aba3e25717850c26c9cd0d89d' ], digests.call('kat.log'))
+        assert_equal([ '84983e441c3bd26ebaae4aa1f95129e5e54670f1' ], digests.call('kat2.log'))
+
+        chunks = files.find { |f| File.basename(f['path']) == 'big.log' }['chunks']
+        assert(chunks.size > 2)
+        missing = [ chunks[1], chunks[-1] ]
+        have = files.map { |f| f['chunks'].map { |c| c['digest'] } }.flatten -
+               missing.map { |c| c['digest'] }
+        x = s.fetchChunks({ 'have' => have })
+        assert_equal(false, x['truncated'])
+        assert_equal(missing.map { |c| [ c['offset'], c['length'], c['digest'] ] },
+                     x['chunks'].map { |c| [ c['offset'], c['length'], c['digest'] ] })
+        x['chunks'].each { |c| assert_equal(big[c['offset'], c['length']], c['data']) }
+
+        # a maxBytes smaller than any chunk still gets one per call
+        x = s.fetchChunks({ 'have' => have, 'maxBytes' => 1 })
+        assert_equal(true, x['truncated'])
+        assert_equal([ missing[0]['digest'] ], x['chunks'].map { |c| c['digest'] })
+      }
+    }
+  end
+
+  def test_get_details
+    modified = Time.utc(2010, 6, 1, 10, 0, 10)
+    with_fixture_logs { |dir|
+      FIXTURE_LOGS.keys.each { |name| File.utime(modified, modified, File.join(dir, name)) }
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        paths = s.get()
+        files = s.get({ 'details' => true })
+        assert_equal(paths.sort, files.map { |f| f['path'] }.sort)
+        got = {}
+        files.each { |f|
+          got[File.basename(f['path'])] = [ f['size'], f['lines'], f['modified'], f['component'] ]
+        }
+        ms = modified.to_i * 1000
+        assert_equal({ 'BrowserPlusCore.log' => [ 382, 6, ms, 'platform/2.9.0' ],
+                       'bpnpapi.log' => [ 204, 3, ms, 'platform/2.9.0' ] }, got)
+      }
+    }
+  end
+
+  def test_read_chunks
+    big = (0...2000).map { |i| "2010-06-01 12:00:00 INFO [5] read.cpp:1 - line #{i}\n" }.join
+    with_fixture_logs(FIXTURE_LOGS.merge({ 'read.log' => big })) { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        path = s.get().find { |p| File.basename(p) == 'read.log' }
+        assert_not_nil(path)
+        data = ''
+        offset = 0
+        loop {
+          x = s.read({ 'file' => path, 'offset' => offset, 'maxBytes' => 4096 })
+          assert_equal(offset, x['offset'])
+          assert(x['data'].size <= 4096)
+          assert_equal(offset + x['data'].size, x['next'])
+          assert_equal("\n", x['data'][-1, 1]) unless x['eof']
+          data += x['data']
+          offset = x['next']
+          break if x['eof']
+        }
+        assert_equal(big, data)
+        assert_raise(RuntimeError) { s.read({ 'file' => path, 'offset' => -1 }) }
+        assert_raise(RuntimeError) { s.read({ 'file' => path, 'offset' => big.size + 1 }) }
+      }
+    }
+  end
+
+  def test_stats
+    BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+      s.resetStats()
+      s.get()
+      s.get()
+      assert_raise(RuntimeError) { s.tail({ 'lines' => -1 }) }
+      x = s.stats()
+      assert_equal(2, x['get']['calls'])
+      assert_equal(1, x['tail']['errors']['bp.invalidArguments'])
+      s.resetStats()
+      assert_nil(s.stats()['get'])
+    }
+  end
+
+  # the platform logs may have been found by warm-up before get asks,
+  # a service nothing has looked up yet can't have been
+  def test_stats_attribution
+    with_fixture_logs(FIXTURE_LOGS, { 'FixtureService' => { 'svc.log' => "hello\n" } }) { |dir|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+        s.resetStats()
+        x = s.getServiceLogs({ 'services' => [ 'FixtureService' ] })
+        assert_equal([ 'svc.log' ], x['FixtureService']['files'].map { |p| File.basename(p) })
+        x = s.stats()
+        assert_equal(1, x['getServiceLogs']['calls'])
+        assert(x['getServiceLogs']['dirsOpened'] > 0)
+        assert(x['getServiceLogs']['entriesScanned'] > 0)
+      }
+    }
+  end
+
   def test_fakeurl
     BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlFake) { |s|
       assert_raise(RuntimeError) { x = s.get() }
     }
   end
+
+  # hosts match regardless of case and of a trailing dot
+  def test_whitelist_case_and_trailing_dot
+    [ "http://WWW.Yahoo.COM/page.html", "http://www.yahoo.com./page.html",
+      "http://LOCALHOST.:#{@server[:Port]}/" ].each { |url|
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, url) { |s|
+        assert_nothing_raised(url) { s.stats() }
+      }
+    }
+  end
+
+  # whitelist.txt beside the service adds domains, without letting in
+  # lookalikes of them
+  def test_whitelist_file
+    file = File.join(@service, 'whitelist.txt')
+    File.open(file, 'w') { |f| f.write("# extra sites\n\n  *.Example.ORG  \n") }
+    begin
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, "http://logs.example.org/") { |s|
+        assert_nothing_raised { s.stats() }
+      }
+      BrowserPlus.run(@service, @providerDir, nil, nil, false, "http://example.org.evil.com/") { |s|
+        assert_raise(RuntimeError) { s.stats() }
+      }
+    ensure
+      File.delete(file)
+    end
+  end
+
+  # the decision for an origin is made once, later calls hit the cache
+  def test_whitelist_cached
+    BrowserPlus.run(@service, @providerDir, nil, nil, false, @urlLocal) { |s|
+      s.resetStats()
+      x = s.stats()
+      assert_equal(1, x['stats']['cacheHits'])
+      assert_equal(0, x['stats']['cacheMisses'])
+      x = s.stats()
+      assert_equal(2, x['stats']['cacheHits'])
+    }
+  end
+
+  def test_fakeurl_lookalike_subdomain
+    url = "http://yahoo.com.fakeyahoo.com/fake.html"
+    BrowserPlus.run(@service, @providerDir, nil, nil, false, url) { |s|
+      assert_raise(RuntimeError) { x = s.get() }
+      assert_raise(RuntimeError) { x = s.get() }
+    }
+  end
 end